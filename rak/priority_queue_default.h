@@ -47,7 +47,7 @@ namespace rak {
 
 class priority_item {
 public:
-  priority_item() {}
+  priority_item() : m_name(NULL) {}
   ~priority_item() {
     if (is_queued())
       throw std::logic_error("priority_item::~priority_item() called on a queued item.");
@@ -61,6 +61,10 @@ public:
 
   void                call()                                  { m_slot(); }
   void                set_slot(function0<void>::base_type* s) { m_slot.set(s); }
+
+  // Optional name used when profiling, must outlive the item.
+  const char*         name() const                            { return m_name; }
+  void                set_name(const char* name)              { m_name = name; }
   
   const timer&        time() const                           { return m_time; }
   void                clear_time()                           { m_time = timer(); }
@@ -74,6 +78,7 @@ private:
 
   timer               m_time;
   function0<void>     m_slot;
+  const char*         m_name;
 };
 
 struct priority_compare {
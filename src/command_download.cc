@@ -36,6 +36,7 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <functional>
 #include <unistd.h>
 #include <cstdio>
@@ -56,7 +57,9 @@
 #include "core/download.h"
 #include "core/download_store.h"
 #include "core/manager.h"
+#include "core/profiler.h"
 #include "rpc/command_variable.h"
+#include "rpc/parse.h"
 
 #include "globals.h"
 #include "control.h"
@@ -170,6 +173,20 @@ apply_d_delete_tied(core::Download* download) {
   rpc::call_command("d.set_tied_to_file", std::string(), rpc::make_target(download));
 }
 
+// Pausing by hand marks the download so that the bandwidth
+// controller doesn't start it again behind the user's back.
+void
+apply_d_pause(core::Download* download) {
+  rpc::call_command("d.set_paused", (int64_t)1, rpc::make_target(download));
+  control->core()->download_list()->pause(download);
+}
+
+void
+apply_d_resume(core::Download* download) {
+  rpc::call_command("d.set_paused", (int64_t)0, rpc::make_target(download));
+  control->core()->download_list()->resume(download);
+}
+
 void
 apply_d_connection_type(core::Download* download, const std::string& name) {
   torrent::Download::ConnectionType connType;
@@ -316,6 +333,65 @@ cmd_d_initialize_logs(core::Download* download) {
   return torrent::Object();
 }
 
+torrent::Object
+cmd_d_bump_generation(core::Download* download) {
+  download->set_generation(control->core()->download_list()->next_generation());
+  return torrent::Object();
+}
+
+// Rough estimate of the heap used by a bencode tree, counting each
+// node and the capacity of its strings.
+uint64_t
+object_memory_usage(const torrent::Object& object) {
+  uint64_t size = sizeof(torrent::Object);
+
+  switch (object.type()) {
+  case torrent::Object::TYPE_STRING:
+    return size + object.as_string().capacity();
+
+  case torrent::Object::TYPE_LIST:
+    for (torrent::Object::list_type::const_iterator itr = object.as_list().begin(), last = object.as_list().end(); itr != last; itr++)
+      size += object_memory_usage(*itr) + 2 * sizeof(void*);
+
+    return size;
+
+  case torrent::Object::TYPE_MAP:
+    for (torrent::Object::map_type::const_iterator itr = object.as_map().begin(), last = object.as_map().end(); itr != last; itr++)
+      size += object_memory_usage(itr->second) + sizeof(std::string) + itr->first.capacity() + 4 * sizeof(void*);
+
+    return size;
+
+  default:
+    return size;
+  }
+}
+
+torrent::Object
+cmd_d_metainfo_memory(core::Download* download) {
+  return (int64_t)object_memory_usage(*download->bencode());
+}
+
+torrent::Object
+cmd_d_metainfo_release(core::Download* download) {
+  return (int64_t)control->core()->download_store()->release_metainfo(download);
+}
+
+torrent::Object
+cmd_d_metainfo_restore(core::Download* download) {
+  return (int64_t)control->core()->download_store()->restore_metainfo(download);
+}
+
+int64_t
+cmd_metainfo_memory() {
+  core::DownloadList* dList = control->core()->download_list();
+  uint64_t size = 0;
+
+  for (core::DownloadList::iterator itr = dList->begin(), last = dList->end(); itr != last; itr++)
+    size += object_memory_usage(*(*itr)->bencode());
+
+  return size;
+}
+
 struct call_add_d_peer_t {
   call_add_d_peer_t(core::Download* d, int port) : m_download(d), m_port(port) { }
 
@@ -372,13 +448,65 @@ f_multicall(core::Download* download, const torrent::Object& rawArgs) {
 
     for (torrent::Object::list_const_iterator cItr = ++args.begin(), cLast = args.end(); cItr != args.end(); cItr++) {
       const std::string& cmd = cItr->as_string();
-      row.push_back(rpc::parse_command(rpc::make_target(*itr), cmd.c_str(), cmd.c_str() + cmd.size()).first);
+      row.push_back(torrent::Object());
+      rpc::parse_command(rpc::make_target(*itr), cmd.c_str(), cmd.c_str() + cmd.size()).first.swap(row.back());
     }
   }
 
   return resultRaw;
 }
 
+// f.multicall.slice=<offset>,<cmd>...
+//
+// Time-sliced f.multicall, see d.multicall.slice.
+torrent::Object
+f_multicall_slice(core::Download* download, const torrent::Object& rawArgs) {
+  const torrent::Object::list_type& args = rawArgs.as_list();
+
+  if (args.empty())
+    throw torrent::input_error("Too few arguments.");
+
+  uint64_t offset = rpc::convert_to_value(args.front());
+
+  rak::timer start    = rak::timer::current();
+  rak::timer deadline = start + rak::timer::from_milliseconds(rpc::call_command_value("get_multicall.slice_budget"));
+
+  torrent::Object             resultRaw = torrent::Object::create_list();
+  torrent::Object::list_type& result    = resultRaw.as_list();
+
+  torrent::Object&            next = *result.insert(result.end(), (int64_t)0);
+  torrent::Object::list_type& rows = result.insert(result.end(), torrent::Object::create_list())->as_list();
+
+  torrent::FileList::const_iterator itr  = download->file_list()->begin() + std::min<uint64_t>(offset, download->file_list()->size_files());
+  torrent::FileList::const_iterator last = download->file_list()->end();
+
+  for (; itr != last; itr++) {
+    if (!rows.empty() && rak::timer::current() >= deadline)
+      break;
+
+    torrent::Object::list_type& row = rows.insert(rows.end(), torrent::Object::create_list())->as_list();
+
+    for (torrent::Object::list_const_iterator cItr = ++args.begin(), cLast = args.end(); cItr != cLast; cItr++) {
+      const std::string& cmd = cItr->as_string();
+
+      row.push_back(torrent::Object());
+      rpc::parse_command(rpc::make_target(*itr), cmd.c_str(), cmd.c_str() + cmd.size()).first.swap(row.back());
+    }
+  }
+
+  if (itr != last)
+    next = (int64_t)(itr - download->file_list()->begin());
+
+  rak::timer elapsed = rak::timer::current() - start;
+
+  if (control->profiler()->is_enabled())
+    control->profiler()->record("multicall.slice", elapsed);
+
+  result.push_back(elapsed.usec());
+
+  return resultRaw;
+}
+
 torrent::Object
 t_multicall(core::Download* download, const torrent::Object& rawArgs) {
   const torrent::Object::list_type& args = rawArgs.as_list();
@@ -401,7 +529,8 @@ t_multicall(core::Download* download, const torrent::Object& rawArgs) {
       const std::string& cmd = cItr->as_string();
       torrent::Tracker* t = download->tracker_list()->at(itr);
 
-      row.push_back(rpc::parse_command(rpc::make_target(t), cmd.c_str(), cmd.c_str() + cmd.size()).first);
+      row.push_back(torrent::Object());
+      rpc::parse_command(rpc::make_target(t), cmd.c_str(), cmd.c_str() + cmd.size()).first.swap(row.back());
     }
   }
 
@@ -429,7 +558,8 @@ p_multicall(core::Download* download, const torrent::Object& rawArgs) {
     for (torrent::Object::list_const_iterator cItr = ++args.begin(), cLast = args.end(); cItr != args.end(); cItr++) {
       const std::string& cmd = cItr->as_string();
 
-      row.push_back(rpc::parse_command(rpc::make_target(*itr), cmd.c_str(), cmd.c_str() + cmd.size()).first);
+      row.push_back(torrent::Object());
+      rpc::parse_command(rpc::make_target(*itr), cmd.c_str(), cmd.c_str() + cmd.size()).first.swap(row.back());
     }
   }
 
@@ -580,14 +710,14 @@ initialize_command_download() {
   ADD_CD_LIST("delete_link",   rak::bind_ptr_fn(&apply_d_change_link, 1));
   ADD_CD_V_VOID("delete_tied", &apply_d_delete_tied);
 
-  CMD_FUNC_SINGLE("d.start",     "d.set_hashing_failed=0 ;view.set_visible=started");
+  CMD_FUNC_SINGLE("d.start",     "d.set_hashing_failed=0 ;d.set_paused=0 ;view.set_visible=started");
   CMD_FUNC_SINGLE("d.stop",      "view.set_visible=stopped");
   CMD_FUNC_SINGLE("d.try_start", "branch=\"or={d.get_hashing_failed=,d.get_ignore_commands=}\",{},{view.set_visible=started}");
   CMD_FUNC_SINGLE("d.try_stop",  "branch=d.get_ignore_commands=, {}, {view.set_visible=stopped}");
   CMD_FUNC_SINGLE("d.try_close", "branch=d.get_ignore_commands=, {}, {view.set_visible=stopped, d.close=}");
 
-  ADD_CD_F_VOID("resume",     rak::make_mem_fun(control->core()->download_list(), &core::DownloadList::resume_default));
-  ADD_CD_F_VOID("pause",      rak::make_mem_fun(control->core()->download_list(), &core::DownloadList::pause_default));
+  ADD_CD_V_VOID("resume",     &apply_d_resume);
+  ADD_CD_V_VOID("pause",      &apply_d_pause);
   ADD_CD_F_VOID("open",       rak::make_mem_fun(control->core()->download_list(), &core::DownloadList::open_throw));
   ADD_CD_F_VOID("close",      rak::make_mem_fun(control->core()->download_list(), &core::DownloadList::close_throw));
   ADD_CD_F_VOID("erase",      rak::make_mem_fun(control->core()->download_list(), &core::DownloadList::erase_ptr));
@@ -649,6 +779,9 @@ initialize_command_download() {
   ADD_CD_VARIABLE_VALUE("state_counter",          "rtorrent", "state_counter");
   ADD_CD_VARIABLE_VALUE_PUBLIC("ignore_commands", "rtorrent", "ignore_commands");
 
+  // Set by 'd.pause' and cleared by 'd.resume' and 'd.start'.
+  ADD_CD_VARIABLE_VALUE_PUBLIC("paused",          "rtorrent", "paused");
+
   ADD_CD_STRING_BI("connection_current", std::ptr_fun(&apply_d_connection_type), std::ptr_fun(&retrieve_d_connection_type));
   ADD_CD_VARIABLE_STRING("connection_leech",      "rtorrent", "connection_leech");
   ADD_CD_VARIABLE_STRING("connection_seed",       "rtorrent", "connection_seed");
@@ -716,9 +849,18 @@ initialize_command_download() {
   ADD_CD_STRING_UNI("priority_str",       std::ptr_fun(&retrieve_d_priority_str));
 
   ADD_CD_SLOT_PUBLIC("f.multicall",       call_list, rak::ptr_fn(&f_multicall), "i:", "");
+  ADD_CD_SLOT_PUBLIC("f.multicall.slice", call_list, rak::ptr_fn(&f_multicall_slice), "i:", "");
   ADD_CD_SLOT_PUBLIC("p.multicall",       call_list, rak::ptr_fn(&p_multicall), "i:", "");
   ADD_CD_SLOT_PUBLIC("t.multicall",       call_list, rak::ptr_fn(&t_multicall), "i:", "");
 
   // NEWISH:
   CMD_D_VOID("d.initialize_logs",         &cmd_d_initialize_logs);
+  CMD_D_VOID("d.bump_generation",         &cmd_d_bump_generation);
+
+  CMD_D_VOID("d.metainfo.memory",          &cmd_d_metainfo_memory);
+  CMD_D_VOID("d.metainfo.release",         &cmd_d_metainfo_release);
+  CMD_D_VOID("d.metainfo.restore",         &cmd_d_metainfo_restore);
+
+  ADD_VARIABLE_BOOL("metainfo.release", false);
+  ADD_COMMAND_VOID("metainfo.memory",      rak::ptr_fun(&cmd_metainfo_memory));
 }
@@ -36,8 +36,12 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <functional>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include <rak/file_stat.h>
 #include <rak/path.h>
 #include <rak/string_manip.h>
@@ -48,7 +52,9 @@
 #include "core/download.h"
 #include "core/download_list.h"
 #include "core/manager.h"
+#include "core/profiler.h"
 #include "core/view_manager.h"
+#include "rpc/command_compiled.h"
 #include "rpc/command_scheduler.h"
 #include "rpc/command_slot.h"
 #include "rpc/command_variable.h"
@@ -229,6 +235,23 @@ apply_schedule(const torrent::Object& rawArgs) {
   return torrent::Object();
 }
 
+torrent::Object
+apply_schedule_jitter(const torrent::Object& rawArgs) {
+  const torrent::Object::list_type& args = rawArgs.as_list();
+
+  if (args.size() != 2)
+    throw torrent::input_error("Wrong number of arguments.");
+
+  int64_t jitter = rpc::convert_to_value(args.back());
+
+  if (jitter < 0)
+    throw torrent::input_error("Invalid jitter.");
+
+  control->command_scheduler()->set_item_jitter(args.front().as_string(), jitter);
+
+  return torrent::Object();
+}
+
 torrent::Object
 apply_load(int flags, const torrent::Object& rawArgs) {
   const torrent::Object::list_type&    args    = rawArgs.as_list();
@@ -251,6 +274,12 @@ apply_load(int flags, const torrent::Object& rawArgs) {
 void apply_import(const std::string& path)     { if (!rpc::parse_command_file(path)) throw torrent::input_error("Could not open option file: " + path); }
 void apply_try_import(const std::string& path) { if (!rpc::parse_command_file(path)) control->core()->push_log_std("Could not read resource file: " + path); }
 
+void
+apply_import_cached(const std::string& path) {
+  if (!rpc::parse_command_file(path, rak::path_expand(path) + ".cache"))
+    throw torrent::input_error("Could not open option file: " + path);
+}
+
 void
 apply_close_low_diskspace(int64_t arg) {
   core::DownloadList* downloadList = control->core()->download_list();
@@ -304,6 +333,22 @@ apply_download_list(const torrent::Object& rawArgs) {
   return result;
 }
 
+typedef std::vector<rpc::CommandCompiled> multicall_columns;
+
+// Compiles the column commands once per multicall rather than parsing
+// every cell. Returns true if all of them are read-only.
+bool
+multicall_compile(torrent::Object::list_const_iterator first, torrent::Object::list_const_iterator last, multicall_columns* columns) {
+  bool readOnly = true;
+
+  for (; first != last; first++) {
+    columns->push_back(rpc::CommandCompiled(first->as_string()));
+    readOnly = columns->back().is_read_only() && readOnly;
+  }
+
+  return readOnly;
+}
+
 torrent::Object
 d_multicall(const torrent::Object& rawArgs) {
   const torrent::Object::list_type&          args = rawArgs.as_list();
@@ -333,20 +378,246 @@ d_multicall(const torrent::Object& rawArgs) {
   if (viewItr == viewManager->end())
     throw torrent::input_error("Could not find view.");
 
-  // Add some pre-parsing of the commands, so we don't spend time
-  // parsing and searching command map for every single call.
+  multicall_columns columns;
+  columns.reserve(args.size() - 1);
+
+  bool readOnly = multicall_compile(++args.begin(), args.end(), &columns);
+
+  // Read-only columns can't move downloads in or out of the view, so
+  // only walk a copy of it when some column might.
+  core::View::base_type snapshot;
+
+  if (!readOnly)
+    snapshot.assign((*viewItr)->begin_visible(), (*viewItr)->end_visible());
+
+  core::View::const_iterator vItr  = readOnly ? (*viewItr)->begin_visible() : snapshot.begin();
+  core::View::const_iterator vLast = readOnly ? (*viewItr)->end_visible() : snapshot.end();
+
   torrent::Object             resultRaw = torrent::Object::create_list();
   torrent::Object::list_type& result = resultRaw.as_list();
 
-  for (core::View::const_iterator vItr = (*viewItr)->begin_visible(), vLast = (*viewItr)->end_visible(); vItr != vLast; vItr++) {
+  for (; vItr != vLast; vItr++) {
     torrent::Object::list_type& row = result.insert(result.end(), torrent::Object::create_list())->as_list();
 
-    for (torrent::Object::list_const_iterator cItr = ++args.begin(), cLast = args.end(); cItr != args.end(); cItr++) {
+    for (multicall_columns::iterator cItr = columns.begin(), cLast = columns.end(); cItr != cLast; cItr++) {
+      row.push_back(torrent::Object());
+      cItr->call(rpc::make_target(*vItr)).swap(row.back());
+    }
+  }
+
+  return resultRaw;
+}
+
+// Columns holding transfer rates, with or without the trailing '='.
+static const char* multicall_rate_commands[] = {
+  "d.get_up_rate",
+  "d.get_down_rate",
+  "d.get_skip_rate",
+  NULL
+};
+
+static bool
+d_multicall_is_rate(const std::string& cmd) {
+  std::string::size_type length = cmd.size();
+
+  if (length != 0 && cmd[length - 1] == '=')
+    length--;
+
+  for (const char** itr = multicall_rate_commands; *itr != NULL; itr++)
+    if (cmd.compare(0, length, *itr) == 0 && std::strlen(*itr) == length)
+      return true;
+
+  return false;
+}
+
+// Compare a freshly evaluated column with the last seen value. Rate
+// columns only count as changed when they move by more than
+// 'threshold', so idle noise doesn't mark every row.
+bool
+d_multicall_changed(bool isRate, int64_t threshold, const torrent::Object& oldValue, const torrent::Object& newValue) {
+  if (oldValue.type() != newValue.type())
+    return true;
+
+  switch (newValue.type()) {
+  case torrent::Object::TYPE_VALUE:
+    if (isRate)
+      return std::abs(newValue.as_value() - oldValue.as_value()) > threshold;
+
+    return newValue.as_value() != oldValue.as_value();
+
+  case torrent::Object::TYPE_STRING:
+    return newValue.as_string() != oldValue.as_string();
+
+  case torrent::Object::TYPE_NONE:
+    return false;
+
+  default:
+    return true;
+  }
+}
+
+// d.multicall.since=<view>,<cursor>,<cmd>...
+//
+// Returns [cursor, rows, removed, full] where each row is [hash, map]
+// holding only the commands whose value changed after 'cursor', and
+// 'removed' the hashes that left the view since then, whether erased,
+// stopped or filtered out. Apply 'removed' before 'rows', as a
+// download may have left and re-entered the view. Pass the returned
+// cursor on the next call, zero requests every column. If 'full' is
+// set the cursor was too old to tell which downloads left, and the
+// client should drop rows not in the reply.
+torrent::Object
+d_multicall_since(const torrent::Object& rawArgs) {
+  const torrent::Object::list_type& args = rawArgs.as_list();
+
+  if (args.size() < 2)
+    throw torrent::input_error("Too few arguments.");
+
+  torrent::Object::list_const_iterator argItr = args.begin();
+
+  core::ViewManager* viewManager = control->view_manager();
+  core::ViewManager::iterator viewItr = viewManager->find(argItr->as_string().empty() ? "default" : argItr->as_string());
+
+  if (viewItr == viewManager->end())
+    throw torrent::input_error("Could not find view.");
+
+  uint64_t cursor = rpc::convert_to_value(*++argItr);
+  ++argItr;
+
+  core::DownloadList* downloadList = control->core()->download_list();
+
+  uint64_t generation = downloadList->next_generation();
+  bool     full       = cursor == 0 || cursor < (*viewItr)->removed_trimmed();
+
+  int64_t           threshold = rpc::call_command_value("get_multicall.rate_threshold");
+  std::vector<bool> isRate;
+
+  for (torrent::Object::list_const_iterator cItr = argItr; cItr != args.end(); cItr++)
+    isRate.push_back(d_multicall_is_rate(cItr->as_string()));
+
+  torrent::Object             resultRaw = torrent::Object::create_list();
+  torrent::Object::list_type& result    = resultRaw.as_list();
+
+  result.push_back((int64_t)generation);
+
+  torrent::Object::list_type& rows = result.insert(result.end(), torrent::Object::create_list())->as_list();
+
+  for (core::View::const_iterator vItr = (*viewItr)->begin_visible(), vLast = (*viewItr)->end_visible(); vItr != vLast; vItr++) {
+    bool changedAll = full || (*vItr)->generation() > cursor;
+
+    torrent::Object columnsRaw = torrent::Object::create_map();
+    std::vector<bool>::const_iterator rateItr = isRate.begin();
+
+    for (torrent::Object::list_const_iterator cItr = argItr; cItr != args.end(); cItr++, rateItr++) {
       const std::string& cmd = cItr->as_string();
-      row.push_back(rpc::parse_command(rpc::make_target(*vItr), cmd.c_str(), cmd.c_str() + cmd.size()).first);
+      torrent::Object value = rpc::parse_command(rpc::make_target(*vItr), cmd.c_str(), cmd.c_str() + cmd.size()).first;
+
+      core::Download::column_map& columnMap = (*vItr)->columns();
+      core::Download::column_map::iterator column = columnMap.find(cmd);
+
+      if (column == columnMap.end()) {
+        // Start over rather than keep every command any client ever
+        // asked for, the dropped columns just get reported again.
+        if (columnMap.size() >= core::Download::max_columns)
+          columnMap.clear();
+
+        column = columnMap.insert(std::make_pair(cmd, std::make_pair(generation, value))).first;
+      }
+
+      else if (d_multicall_changed(*rateItr, threshold, column->second.second, value))
+        column->second = std::make_pair(generation, value);
+
+      if (changedAll || column->second.first > cursor)
+        columnsRaw.insert_key(cmd, value);
     }
+
+    if (columnsRaw.as_map().empty())
+      continue;
+
+    const torrent::HashString* hashString = &(*vItr)->download()->info_hash();
+
+    torrent::Object::list_type& row = rows.insert(rows.end(), torrent::Object::create_list())->as_list();
+    row.push_back(rak::transform_hex(hashString->begin(), hashString->end()));
+    row.push_back(torrent::Object());
+    row.back().swap(columnsRaw);
   }
 
+  torrent::Object::list_type& removed = result.insert(result.end(), torrent::Object::create_list())->as_list();
+
+  for (core::View::removed_list::const_iterator itr = (*viewItr)->removed().begin(), last = (*viewItr)->removed().end(); itr != last; itr++)
+    if (itr->first > cursor)
+      removed.push_back(itr->second);
+
+  result.push_back((int64_t)full);
+
+  return resultRaw;
+}
+
+// d.multicall.slice=<view>,<offset>,<cmd>...
+//
+// Like d.multicall, but starts at row 'offset' of the view and stops
+// once 'multicall.slice_budget' milliseconds have passed, so huge
+// views can be walked without stalling the main loop. Returns
+// [next_offset, rows, usec] where 'next_offset' is zero once the view
+// is exhausted. Downloads moving within the view between calls may be
+// skipped or returned twice.
+torrent::Object
+d_multicall_slice(const torrent::Object& rawArgs) {
+  const torrent::Object::list_type& args = rawArgs.as_list();
+
+  if (args.size() < 2)
+    throw torrent::input_error("Too few arguments.");
+
+  torrent::Object::list_const_iterator argItr = args.begin();
+
+  core::ViewManager* viewManager = control->view_manager();
+  core::ViewManager::iterator viewItr = viewManager->find(argItr->as_string().empty() ? "default" : argItr->as_string());
+
+  if (viewItr == viewManager->end())
+    throw torrent::input_error("Could not find view.");
+
+  uint64_t offset = rpc::convert_to_value(*++argItr);
+  ++argItr;
+
+  multicall_columns columns;
+  columns.reserve(args.size() - 2);
+  multicall_compile(argItr, args.end(), &columns);
+
+  rak::timer start    = rak::timer::current();
+  rak::timer deadline = start + rak::timer::from_milliseconds(rpc::call_command_value("get_multicall.slice_budget"));
+
+  torrent::Object             resultRaw = torrent::Object::create_list();
+  torrent::Object::list_type& result    = resultRaw.as_list();
+
+  torrent::Object&            next = *result.insert(result.end(), (int64_t)0);
+  torrent::Object::list_type& rows = result.insert(result.end(), torrent::Object::create_list())->as_list();
+
+  core::View::const_iterator vItr  = (*viewItr)->begin_visible() + std::min<uint64_t>(offset, (*viewItr)->size_visible());
+  core::View::const_iterator vLast = (*viewItr)->end_visible();
+
+  // Always do at least one row so the caller makes progress.
+  for (; vItr != vLast; vItr++) {
+    if (!rows.empty() && rak::timer::current() >= deadline)
+      break;
+
+    torrent::Object::list_type& row = rows.insert(rows.end(), torrent::Object::create_list())->as_list();
+
+    for (multicall_columns::iterator cItr = columns.begin(), cLast = columns.end(); cItr != cLast; cItr++) {
+      row.push_back(torrent::Object());
+      cItr->call(rpc::make_target(*vItr)).swap(row.back());
+    }
+  }
+
+  if (vItr != vLast)
+    next = (int64_t)(vItr - (*viewItr)->begin_visible());
+
+  rak::timer elapsed = rak::timer::current() - start;
+
+  if (control->profiler()->is_enabled())
+    control->profiler()->record("multicall.slice", elapsed);
+
+  result.push_back(elapsed.usec());
+
   return resultRaw;
 }
 
@@ -377,9 +648,15 @@ initialize_command_events() {
 
   ADD_COMMAND_LIST("schedule",                rak::ptr_fn(&apply_schedule));
   ADD_COMMAND_STRING_UN("schedule_remove",    rak::make_mem_fun(control->command_scheduler(), &rpc::CommandScheduler::erase_str));
+  ADD_COMMAND_LIST("schedule_jitter",         rak::ptr_fn(&apply_schedule_jitter));
+
+  ADD_COMMAND_VOID("scheduler.items",         rak::make_mem_fun(control->command_scheduler(), &rpc::CommandScheduler::status));
+  ADD_COMMAND_VALUE_TRI("scheduler.jitter",      rak::make_mem_fun(control->command_scheduler(), &rpc::CommandScheduler::set_jitter), rak::make_mem_fun(control->command_scheduler(), &rpc::CommandScheduler::jitter));
+  ADD_COMMAND_VALUE_TRI("scheduler.tick_budget", rak::make_mem_fun(control->command_scheduler(), &rpc::CommandScheduler::set_tick_budget), rak::make_mem_fun(control->command_scheduler(), &rpc::CommandScheduler::tick_budget));
 
   ADD_COMMAND_STRING_UN("import",             std::ptr_fun(&apply_import));
   ADD_COMMAND_STRING_UN("try_import",         std::ptr_fun(&apply_try_import));
+  ADD_COMMAND_STRING_UN("import.cached",      std::ptr_fun(&apply_import_cached));
 
   ADD_COMMAND_LIST("load",                    rak::bind_ptr_fn(&apply_load, core::Manager::create_quiet | core::Manager::create_tied));
   ADD_COMMAND_LIST("load_verbose",            rak::bind_ptr_fn(&apply_load, core::Manager::create_tied));
@@ -394,4 +671,8 @@ initialize_command_events() {
   ADD_COMMAND_LIST("download_list",           rak::ptr_fn(&apply_download_list));
   ADD_COMMAND_LIST("d.multicall",             rak::ptr_fn(&d_multicall));
   ADD_COMMAND_COPY("call_download",           call_list, "i:", "");
+  ADD_COMMAND_LIST("d.multicall.since",       rak::ptr_fn(&d_multicall_since));
+  ADD_VARIABLE_VALUE("multicall.rate_threshold", 1024);
+  ADD_COMMAND_LIST("d.multicall.slice",       rak::ptr_fn(&d_multicall_slice));
+  ADD_VARIABLE_VALUE("multicall.slice_budget", 50);
 }
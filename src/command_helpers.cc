@@ -36,6 +36,7 @@
 
 #include "config.h"
 
+#include <cstring>
 #include <torrent/exceptions.h>
 
 #include "rpc/command_slot.h"
@@ -76,6 +77,30 @@ void initialize_command_tracker();
 void initialize_command_scheduler();
 void initialize_command_ui();
 
+// Commands without a "get_" prefix that are free of side effects.
+static const char* command_read_only_keys[] = {
+  "d.multicall", "f.multicall", "p.multicall", "t.multicall",
+  "download_list", "view_list",
+  "system.client_version", "system.library_version", "system.hostname", "system.pid", "system.time",
+  NULL
+};
+
+// Getters are marked read-only so the RPC response cache may store
+// replies that only used these.
+void
+initialize_read_only() {
+  for (rpc::CommandMap::iterator itr = rpc::commands.begin(), last = rpc::commands.end(); itr != last; itr++) {
+    const char* name = std::strchr(itr->first, '.');
+    name = name != NULL ? name + 1 : itr->first;
+
+    if (std::strncmp(name, "get_", 4) == 0)
+      itr->second.m_flags |= rpc::CommandMap::flag_read_only;
+  }
+
+  for (const char** key = command_read_only_keys; *key != NULL; ++key)
+    rpc::commands.set_read_only(*key);
+}
+
 void
 initialize_commands() {
   initialize_command_object();
@@ -112,6 +137,8 @@ initialize_commands() {
       commandAnySlotsItr != commandAnySlots + COMMAND_ANY_SLOTS_SIZE)
 #endif
     throw torrent::internal_error("initialize_commands() static command array size mismatch.");
+
+  initialize_read_only();
 }
 
 void
@@ -48,7 +48,7 @@ namespace rpc {
 
 // By using a static array we avoid allocating the variables on the
 // heap. This should reduce memory use and improve cache locality.
-#define COMMAND_SLOTS_SIZE          200
+#define COMMAND_SLOTS_SIZE          250
 #define COMMAND_VARIABLES_SIZE      100
 #define COMMAND_OBJECT_PTR_SIZE     20
 #define COMMAND_DOWNLOAD_SLOTS_SIZE 150
@@ -45,12 +45,15 @@
 #include <torrent/torrent.h>
 #include <torrent/chunk_manager.h>
 
+#include "core/benchmark.h"
 #include "core/download_list.h"
 #include "core/download_store.h"
 #include "core/manager.h"
+#include "core/profiler.h"
 #include "rak/string_manip.h"
 #include "rpc/command_slot.h"
 #include "rpc/command_variable.h"
+#include "rpc/parse.h"
 #include "rpc/parse_commands.h"
 #include "rpc/scgi.h"
 #include "utils/file_status_cache.h"
@@ -147,6 +150,13 @@ check_name(const std::string& str) {
   return str;
 }  
 
+torrent::Object
+system_argument(int index, __UNUSED rpc::target_type target, __UNUSED const torrent::Object& rawArgs) {
+  const torrent::Object* arg = rpc::ArgumentFrame::find(index);
+
+  return arg != NULL ? *arg : torrent::Object();
+}
+
 torrent::Object
 group_insert(__UNUSED rpc::target_type target, const torrent::Object& rawArgs) {
   torrent::Object::list_const_iterator itr = rawArgs.as_list().begin();
@@ -167,11 +177,52 @@ group_insert(__UNUSED rpc::target_type target, const torrent::Object& rawArgs) {
   return name;
 }
 
+static uint32_t
+benchmark_iterations(torrent::Object::list_const_iterator itr, torrent::Object::list_const_iterator last) {
+  if (itr == last)
+    return 100;
+
+  int64_t iterations = rpc::convert_to_value(*itr);
+
+  if (iterations <= 0 || iterations > (1 << 24))
+    throw torrent::input_error("Invalid number of iterations.");
+
+  return iterations;
+}
+
+torrent::Object
+system_benchmark(__UNUSED rpc::target_type target, const torrent::Object& rawArgs) {
+  torrent::Object::list_const_iterator itr = rawArgs.as_list().begin();
+  torrent::Object::list_const_iterator last = rawArgs.as_list().end();
+
+  const std::string& name = post_increment(itr, last)->as_string();
+  core::benchmark_result result = core::benchmark_run(name, benchmark_iterations(itr, last));
+
+  torrent::Object resultMap = torrent::Object::create_map();
+  resultMap.insert_key("operations",  (int64_t)result.m_operations);
+  resultMap.insert_key("usec",        result.m_usec);
+  resultMap.insert_key("nsec_per_op", result.m_operations != 0 ? result.m_usec * 1000 / (int64_t)result.m_operations : (int64_t)0);
+
+  return resultMap;
+}
+
+torrent::Object
+system_benchmark_dump(__UNUSED rpc::target_type target, const torrent::Object& rawArgs) {
+  torrent::Object::list_const_iterator itr = rawArgs.as_list().begin();
+  torrent::Object::list_const_iterator last = rawArgs.as_list().end();
+
+  const std::string& filename = post_increment(itr, last)->as_string();
+  core::benchmark_dump(filename, benchmark_iterations(itr, last));
+
+  return torrent::Object();
+}
+
 void
 initialize_command_local() {
   torrent::ChunkManager* chunkManager = torrent::chunk_manager();
   core::DownloadList*    dList = control->core()->download_list();
   core::DownloadStore*   dStore = control->core()->download_store();
+  core::Profiler*        profiler = control->profiler();
 
   ADD_C_STRING("system.client_version",          PACKAGE_VERSION);
   ADD_C_STRING("system.library_version",         torrent::version());
@@ -188,6 +239,15 @@ initialize_command_local() {
   ADD_COMMAND_VOID("system.time_seconds",            rak::ptr_fun(&rak::timer::current_seconds));
   ADD_COMMAND_VOID("system.time_usec",               rak::ptr_fun(&rak::timer::current_usec));
 
+  ADD_COMMAND_VALUE_UN("system.profile.enable",      rak::make_mem_fun(profiler, &core::Profiler::set_enabled));
+  ADD_COMMAND_VOID("system.profile.enabled",         rak::make_mem_fun(profiler, &core::Profiler::is_enabled));
+  ADD_COMMAND_VOID("system.profile.reset",           rak::make_mem_fun(profiler, &core::Profiler::reset));
+  ADD_COMMAND_VOID("system.profile.list",            rak::make_mem_fun(profiler, &core::Profiler::list));
+  ADD_COMMAND_STRING_UN("system.profile.dump",       rak::make_mem_fun(profiler, &core::Profiler::dump));
+
+  CMD_N_LIST("system.benchmark",                     rak::ptr_fn(&system_benchmark));
+  CMD_N_LIST("system.benchmark.dump",                rak::ptr_fn(&system_benchmark_dump));
+
   ADD_COMMAND_VALUE_SET_OCT("system.", "umask",      std::ptr_fun(&umask));
   ADD_COMMAND_STRING_PREFIX("system.", "cwd",        std::ptr_fun(system_set_cwd), rak::ptr_fun(&system_get_cwd));
 
@@ -226,14 +286,10 @@ initialize_command_local() {
   ADD_COMMAND_STRING("log.execute", rak::bind_ptr_fn(&apply_log, 0));
   ADD_COMMAND_STRING("log.xmlrpc",  rak::bind_ptr_fn(&apply_log, 1));
 
-  *rpc::Command::argument(0) = "placeholder.0";
-  *rpc::Command::argument(1) = "placeholder.1";
-  *rpc::Command::argument(2) = "placeholder.2";
-  *rpc::Command::argument(3) = "placeholder.3";
-  CMD_OBJ_P("argument.0", get_generic, rpc::Command::argument(0));
-  CMD_OBJ_P("argument.1", get_generic, rpc::Command::argument(1));
-  CMD_OBJ_P("argument.2", get_generic, rpc::Command::argument(2));
-  CMD_OBJ_P("argument.3", get_generic, rpc::Command::argument(3));
+  CMD_N("argument.0", rak::bind_ptr_fn(&system_argument, 0));
+  CMD_N("argument.1", rak::bind_ptr_fn(&system_argument, 1));
+  CMD_N("argument.2", rak::bind_ptr_fn(&system_argument, 2));
+  CMD_N("argument.3", rak::bind_ptr_fn(&system_argument, 3));
 
   CMD_N_LIST("group.insert", rak::ptr_fn(&group_insert));
 }
@@ -40,6 +40,7 @@
 #include <cstdio>
 #include <rak/address_info.h>
 #include <rak/path.h>
+#include <rak/string_manip.h>
 #include <torrent/connection_manager.h>
 #include <torrent/dht_manager.h>
 #include <torrent/throttle.h>
@@ -51,6 +52,10 @@
 #include "core/dht_manager.h"
 #include "core/download.h"
 #include "core/manager.h"
+#include "core/metrics.h"
+#include "core/slot_allocator.h"
+#include "rpc/capture_replay.h"
+#include "rpc/event_stream.h"
 #include "rpc/scgi.h"
 #include "ui/root.h"
 #include "rpc/command_slot.h"
@@ -176,6 +181,11 @@ apply_address_throttle(const torrent::Object& rawArgs) {
   return torrent::Object();
 }
 
+int64_t
+retrieve_ip_filter_size() {
+  return control->core()->ip_filter().size();
+}
+
 torrent::Object
 apply_encryption(const torrent::Object& rawArgs) {
   const torrent::Object::list_type& args = rawArgs.as_list();
@@ -307,19 +317,7 @@ initialize_xmlrpc() {
   rpc::xmlrpc.set_slot_find_file(rak::ptr_fn(&xmlrpc_find_file));
   rpc::xmlrpc.set_slot_find_tracker(rak::ptr_fn(&xmlrpc_find_tracker));
 
-  unsigned int count = 0;
-
-  for (rpc::CommandMap::const_iterator itr = rpc::commands.begin(), last = rpc::commands.end(); itr != last; itr++, count++) {
-    if (!(itr->second.m_flags & rpc::CommandMap::flag_public_xmlrpc))
-      continue;
-
-    rpc::xmlrpc.insert_command(itr->first, itr->second.m_parm, itr->second.m_doc);
-  }
-
-  char buffer[128];
-  sprintf(buffer, "XMLRPC initialized with %u functions.", count);
-
-  control->core()->push_log(buffer);
+  control->core()->push_log("XMLRPC initialized, functions are registered on the first request.");
 }
 
 void
@@ -384,10 +382,57 @@ apply_scgi(const std::string& arg, int type) {
     throw torrent::input_error(e.what());
   }
 
-  control->scgi()->set_slot_process(rak::mem_fn(&rpc::xmlrpc, &rpc::XmlRpc::process));
+  control->scgi()->set_slot_process(rak::mem_fn(&rpc::xmlrpc, &rpc::XmlRpc::process_async));
+  control->scgi()->set_slot_metrics(rak::mem_fn(control->metrics(), &core::Metrics::render));
   control->scgi()->activate();
 }
 
+// Download events forwarded to event stream subscribers.
+static const char* event_stream_events[] = {
+  "inserted", "erased", "opened", "closed", "resumed", "paused",
+  "finished", "hash_done", "hash_queued", "hash_removed", NULL
+};
+
+void
+apply_event_stream(const std::string& arg) {
+  if (control->event_stream() != NULL)
+    throw torrent::input_error("Event stream already enabled.");
+
+  rpc::EventStream* eventStream = new rpc::EventStream;
+
+  try {
+    eventStream->open_named(rak::path_expand(arg));
+  } catch (torrent::input_error&) {
+    delete eventStream;
+    throw;
+  }
+
+  control->set_event_stream(eventStream);
+
+  for (const char** itr = event_stream_events; *itr != NULL; itr++)
+    rpc::commands.call("system.method.set_key", rpc::create_object_list(std::string("event.download.") + *itr, "~event_stream", std::string("event_stream.push=") + *itr));
+}
+
+// Line format is "<event> <info hash> <active> <complete>".
+torrent::Object
+cmd_event_stream_push(core::Download* download, const torrent::Object& rawArgs) {
+  if (control->event_stream() == NULL)
+    return torrent::Object();
+
+  const torrent::HashString* hashString = &download->download()->info_hash();
+
+  control->event_stream()->push(rawArgs.as_string() + ' ' +
+                                rak::transform_hex(hashString->begin(), hashString->end()) +
+                                (download->is_active() ? " 1" : " 0") +
+                                (download->is_done() ? " 1" : " 0"));
+  return torrent::Object();
+}
+
+int64_t
+retrieve_event_stream_size() {
+  return control->event_stream() != NULL ? control->event_stream()->size() : 0;
+}
+
 void
 apply_xmlrpc_dialect(const std::string& arg) {
   int value;
@@ -404,6 +449,45 @@ apply_xmlrpc_dialect(const std::string& arg) {
   rpc::xmlrpc.set_dialect(value);
 }
 
+torrent::Object
+apply_xmlrpc_capture(const torrent::Object& rawArgs) {
+  if (rawArgs.is_string() && !rawArgs.as_string().empty())
+    rpc::xmlrpc.capture()->open(rawArgs.as_string());
+  else
+    rpc::xmlrpc.capture()->close();
+
+  return torrent::Object();
+}
+
+// xmlrpc.replay=<file>[,<speed>[,<include_mutating>]]
+torrent::Object
+apply_xmlrpc_replay(const torrent::Object& rawArgs) {
+  std::string filename;
+  int64_t     speed = 1;
+  int64_t     mutating = 0;
+
+  if (rawArgs.is_string()) {
+    filename = rawArgs.as_string();
+
+  } else if (rawArgs.is_list() && !rawArgs.as_list().empty()) {
+    torrent::Object::list_const_iterator itr = rawArgs.as_list().begin(), last = rawArgs.as_list().end();
+
+    filename = itr->as_string();
+
+    if (++itr != last)
+      speed = rpc::convert_to_value(*itr);
+
+    if (itr != last && ++itr != last)
+      mutating = rpc::convert_to_value(*itr);
+  }
+
+  if (filename.empty())
+    throw torrent::input_error("No RPC capture file given.");
+
+  control->capture_replay()->start(filename, speed, mutating);
+  return torrent::Object();
+}
+
 void
 initialize_command_network() {
   torrent::ConnectionManager* cm = torrent::connection_manager();
@@ -431,6 +515,16 @@ initialize_command_network() {
   ADD_VARIABLE_VALUE("max_downloads_div",    1);
   ADD_VARIABLE_VALUE("max_downloads_global", 0);
 
+  core::SlotAllocator* slotAllocator = control->slot_allocator();
+
+  ADD_COMMAND_VOID("network.budget.rebalance", rak::make_mem_fun(slotAllocator, &core::SlotAllocator::rebalance));
+  ADD_COMMAND_VOID("network.budget.status",    rak::make_mem_fun(slotAllocator, &core::SlotAllocator::status));
+
+  ADD_COMMAND_VALUE_TRI("network.budget.interval",  rak::make_mem_fun(slotAllocator, &core::SlotAllocator::set_interval), rak::make_mem_fun(slotAllocator, &core::SlotAllocator::interval));
+  ADD_COMMAND_VALUE_TRI("network.budget.min_peers", rak::make_mem_fun(slotAllocator, &core::SlotAllocator::set_min_peers), rak::make_mem_fun(slotAllocator, &core::SlotAllocator::min_peers));
+  ADD_COMMAND_VALUE_TRI("network.budget.uploads",   rak::make_mem_fun(slotAllocator, &core::SlotAllocator::set_uploads), rak::make_mem_fun(slotAllocator, &core::SlotAllocator::uploads));
+  ADD_COMMAND_VALUE_TRI("network.budget.reserve",   rak::make_mem_fun(slotAllocator, &core::SlotAllocator::set_reserve), rak::make_mem_fun(slotAllocator, &core::SlotAllocator::reserve));
+
 //   ADD_COMMAND_VALUE_TRI("max_uploads_global",   rak::make_mem_fun(control->ui(), &ui::Root::set_max_uploads_global), rak::make_mem_fun(control->ui(), &ui::Root::max_uploads_global));
 //   ADD_COMMAND_VALUE_TRI("max_downloads_global", rak::make_mem_fun(control->ui(), &ui::Root::set_max_downloads_global), rak::make_mem_fun(control->ui(), &ui::Root::max_downloads_global));
 
@@ -448,6 +542,10 @@ initialize_command_network() {
   ADD_COMMAND_LIST("throttle_down",       rak::bind_ptr_fn(&apply_throttle, false));
   ADD_COMMAND_LIST("throttle_ip",         rak::ptr_fn(&apply_address_throttle));
 
+  ADD_COMMAND_STRING_UN("ip_filter.load",  rak::make_mem_fun(control->core(), &core::Manager::load_ip_filter));
+  ADD_COMMAND_VOID("ip_filter.clear",      rak::make_mem_fun(control->core(), &core::Manager::clear_ip_filter));
+  ADD_COMMAND_VOID("ip_filter.size",       rak::ptr_fun(&retrieve_ip_filter_size));
+
   ADD_COMMAND_STRING("get_throttle_up_max",    rak::bind_ptr_fn(&retrieve_throttle_info, throttle_info_up | throttle_info_max));
   ADD_COMMAND_STRING("get_throttle_up_rate",   rak::bind_ptr_fn(&retrieve_throttle_info, throttle_info_up | throttle_info_rate));
   ADD_COMMAND_STRING("get_throttle_down_max",  rak::bind_ptr_fn(&retrieve_throttle_info, throttle_info_down | throttle_info_max));
@@ -475,9 +573,34 @@ initialize_command_network() {
   ADD_COMMAND_STRING_UN("scgi_port",            rak::bind2nd(std::ptr_fun(&apply_scgi), 1));
   ADD_COMMAND_STRING_UN("scgi_local",           rak::bind2nd(std::ptr_fun(&apply_scgi), 2));
   ADD_VARIABLE_BOOL    ("scgi_dont_route", false);
+
+  ADD_COMMAND_STRING_UN("event_stream",         std::ptr_fun(&apply_event_stream));
+  ADD_COMMAND_VOID("event_stream.clients",      rak::ptr_fun(&retrieve_event_stream_size));
+  CMD_D_STRING("event_stream.push",             rak::ptr_fn(&cmd_event_stream_push));
+
+  ADD_COMMAND_VOID("system.metrics",            rak::make_mem_fun(control->metrics(), &core::Metrics::render));
+  ADD_VARIABLE_VALUE("metrics.cache_interval",  5);
+  ADD_VARIABLE_BOOL("metrics.per_download",     false);
   ADD_COMMAND_STRING_UN("xmlrpc_dialect",       std::ptr_fun(&apply_xmlrpc_dialect));
   ADD_COMMAND_VALUE_TRI("xmlrpc_size_limit",    std::ptr_fun(&rpc::XmlRpc::set_size_limit), rak::ptr_fun(&rpc::XmlRpc::size_limit));
 
+  ADD_COMMAND_VOID("xmlrpc.stats.requests",     rak::make_mem_fun(&rpc::xmlrpc, &rpc::XmlRpc::stats_requests));
+  ADD_COMMAND_VOID("xmlrpc.stats.objects",      rak::make_mem_fun(&rpc::xmlrpc, &rpc::XmlRpc::stats_objects));
+  ADD_COMMAND_VOID("xmlrpc.stats.objects_last", rak::make_mem_fun(&rpc::xmlrpc, &rpc::XmlRpc::stats_objects_last));
+  ADD_COMMAND_VOID("xmlrpc.stats.objects_peak", rak::make_mem_fun(&rpc::xmlrpc, &rpc::XmlRpc::stats_objects_peak));
+
+  ADD_COMMAND_VALUE_TRI("xmlrpc.cache.ttl",     rak::make_mem_fun(rpc::xmlrpc.cache(), &rpc::ResponseCache::set_ttl), rak::make_mem_fun(rpc::xmlrpc.cache(), &rpc::ResponseCache::ttl));
+  ADD_COMMAND_VOID("xmlrpc.cache.hits",         rak::make_mem_fun(rpc::xmlrpc.cache(), &rpc::ResponseCache::hits));
+  ADD_COMMAND_VOID("xmlrpc.cache.misses",       rak::make_mem_fun(rpc::xmlrpc.cache(), &rpc::ResponseCache::misses));
+  ADD_COMMAND_VOID("xmlrpc.cache.size",         rak::make_mem_fun(rpc::xmlrpc.cache(), &rpc::ResponseCache::size));
+
+  ADD_COMMAND_VALUE_TRI("xmlrpc.workers",       rak::make_mem_fun(&rpc::xmlrpc, &rpc::XmlRpc::set_workers_size), rak::make_mem_fun(&rpc::xmlrpc, &rpc::XmlRpc::workers_size));
+
+  ADD_COMMAND_STRING("xmlrpc.capture",          rak::ptr_fn(&apply_xmlrpc_capture));
+  ADD_COMMAND_LIST("xmlrpc.replay",             rak::ptr_fn(&apply_xmlrpc_replay));
+  ADD_COMMAND_VOID("xmlrpc.replay.stop",        rak::make_mem_fun(control->capture_replay(), &rpc::CaptureReplay::stop));
+  ADD_COMMAND_VOID("xmlrpc.replay.status",      rak::make_mem_fun(control->capture_replay(), &rpc::CaptureReplay::status));
+
   ADD_COMMAND_VALUE_TRI("hash_read_ahead",      std::ptr_fun(&apply_hash_read_ahead), rak::ptr_fun(torrent::hash_read_ahead));
   ADD_COMMAND_VALUE_TRI("hash_interval",        std::ptr_fun(&apply_hash_interval), rak::ptr_fun(torrent::hash_interval));
 
@@ -493,6 +616,6 @@ initialize_command_network() {
   ADD_VARIABLE_BOOL("peer_exchange", true);
 
   // Not really network stuff:
-  ADD_VARIABLE_BOOL  ("handshake_log", false);
+  ADD_COMMAND_VALUE_TRI("handshake_log",       rak::make_mem_fun(control->core(), &core::Manager::set_handshake_log), rak::make_mem_fun(control->core(), &core::Manager::is_handshake_log));
   ADD_VARIABLE_STRING("log.tracker", "");
 }
@@ -39,6 +39,8 @@
 #include "core/manager.h"
 #include "core/download.h"
 #include "core/download_list.h"
+#include "core/bandwidth_controller.h"
+#include "core/queue_manager.h"
 #include "core/view.h"
 #include "core/view_manager.h"
 #include "rpc/command_variable.h"
@@ -121,4 +123,33 @@ initialize_command_scheduler() {
   CMD_D_ANY("scheduler.simple.added",   rak::ptr_fn(&cmd_scheduler_simple_added));
   CMD_D_ANY("scheduler.simple.removed", rak::ptr_fn(&cmd_scheduler_simple_removed));
   CMD_D_ANY("scheduler.simple.update",  rak::ptr_fn(&cmd_scheduler_simple_update));
+
+  core::QueueManager* queueManager = control->queue_manager();
+
+  CMD_D_SLOT("scheduler.queue.added",    call_unknown, rpc::object_void_fn<core::Download*>(rak::make_mem_fun(queueManager, &core::QueueManager::insert)), "i:", "");
+  CMD_D_SLOT("scheduler.queue.removed",  call_unknown, rpc::object_void_fn<core::Download*>(rak::make_mem_fun(queueManager, &core::QueueManager::erase)), "i:", "");
+  CMD_D_SLOT("scheduler.queue.finished", call_unknown, rpc::object_void_fn<core::Download*>(rak::make_mem_fun(queueManager, &core::QueueManager::finished)), "i:", "");
+  CMD_D_SLOT("scheduler.queue.paused",   call_unknown, rpc::object_void_fn<core::Download*>(rak::make_mem_fun(queueManager, &core::QueueManager::paused)), "i:", "");
+  CMD_D_SLOT("scheduler.queue.resumed",  call_unknown, rpc::object_void_fn<core::Download*>(rak::make_mem_fun(queueManager, &core::QueueManager::resumed)), "i:", "");
+
+  ADD_COMMAND_VOID("scheduler.queue.update", rak::make_mem_fun(queueManager, &core::QueueManager::update));
+  ADD_COMMAND_VOID("scheduler.queue.status", rak::make_mem_fun(queueManager, &core::QueueManager::status));
+
+  ADD_COMMAND_VALUE_TRI("scheduler.queue.max_downloading", rak::make_mem_fun(queueManager, &core::QueueManager::set_max_downloading), rak::make_mem_fun(queueManager, &core::QueueManager::max_downloading));
+  ADD_COMMAND_VALUE_TRI("scheduler.queue.max_seeding",     rak::make_mem_fun(queueManager, &core::QueueManager::set_max_seeding), rak::make_mem_fun(queueManager, &core::QueueManager::max_seeding));
+  ADD_COMMAND_VALUE_TRI("scheduler.queue.max_per_disk",    rak::make_mem_fun(queueManager, &core::QueueManager::set_max_per_disk), rak::make_mem_fun(queueManager, &core::QueueManager::max_per_disk));
+  ADD_COMMAND_VALUE_TRI("scheduler.queue.max_per_tracker", rak::make_mem_fun(queueManager, &core::QueueManager::set_max_per_tracker), rak::make_mem_fun(queueManager, &core::QueueManager::max_per_tracker));
+  ADD_COMMAND_VALUE_TRI("scheduler.queue.aging",           rak::make_mem_fun(queueManager, &core::QueueManager::set_aging), rak::make_mem_fun(queueManager, &core::QueueManager::aging));
+
+  core::BandwidthController* bandwidthController = control->bandwidth_controller();
+
+  ADD_COMMAND_VOID("scheduler.bandwidth.status", rak::make_mem_fun(bandwidthController, &core::BandwidthController::status));
+
+  ADD_COMMAND_VALUE_TRI   ("scheduler.bandwidth.interval",       rak::make_mem_fun(bandwidthController, &core::BandwidthController::set_interval), rak::make_mem_fun(bandwidthController, &core::BandwidthController::interval));
+  ADD_COMMAND_VALUE_TRI_KB("scheduler.bandwidth.down_capacity",  rak::make_mem_fun(bandwidthController, &core::BandwidthController::set_down_capacity), rak::make_mem_fun(bandwidthController, &core::BandwidthController::down_capacity));
+  ADD_COMMAND_VALUE_TRI_KB("scheduler.bandwidth.up_capacity",    rak::make_mem_fun(bandwidthController, &core::BandwidthController::set_up_capacity), rak::make_mem_fun(bandwidthController, &core::BandwidthController::up_capacity));
+  ADD_COMMAND_VALUE_TRI   ("scheduler.bandwidth.low_watermark",  rak::make_mem_fun(bandwidthController, &core::BandwidthController::set_low_watermark), rak::make_mem_fun(bandwidthController, &core::BandwidthController::low_watermark));
+  ADD_COMMAND_VALUE_TRI   ("scheduler.bandwidth.high_watermark", rak::make_mem_fun(bandwidthController, &core::BandwidthController::set_high_watermark), rak::make_mem_fun(bandwidthController, &core::BandwidthController::high_watermark));
+  ADD_COMMAND_VALUE_TRI   ("scheduler.bandwidth.min_runtime",    rak::make_mem_fun(bandwidthController, &core::BandwidthController::set_min_runtime), rak::make_mem_fun(bandwidthController, &core::BandwidthController::min_runtime));
+  ADD_COMMAND_VALUE_TRI   ("scheduler.bandwidth.max_active",     rak::make_mem_fun(bandwidthController, &core::BandwidthController::set_max_active), rak::make_mem_fun(bandwidthController, &core::BandwidthController::max_active));
 }
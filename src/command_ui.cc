@@ -37,6 +37,7 @@
 #include "config.h"
 
 #include <ctime>
+#include <map>
 #include <rak/functional.h>
 #include <rak/functional_fun.h>
 #include <sigc++/adaptors/bind.h>
@@ -47,6 +48,7 @@
 #include "ui/download_list.h"
 #include "rpc/command_slot.h"
 #include "rpc/command_variable.h"
+#include "rpc/expression.h"
 #include "rpc/parse.h"
 
 #include "globals.h"
@@ -249,6 +251,34 @@ apply_greater(rpc::target_type target, const torrent::Object& rawArgs) {
   return (int64_t)!apply_less(target, rawArgs).as_value();
 }
 
+// Expressions used outside of views are kept compiled by their
+// string, the cache is simply dropped when it grows too large.
+torrent::Object
+apply_expr(rpc::target_type target, const torrent::Object& rawArgs) {
+  typedef std::map<std::string, rpc::Expression> expression_cache;
+
+  static expression_cache cache;
+  static const expression_cache::size_type max_size = 64;
+
+  if (!rawArgs.is_string())
+    throw torrent::input_error("Expression must be a string.");
+
+  const std::string& str = rawArgs.as_string();
+  expression_cache::iterator itr = cache.find(str);
+
+  if (itr == cache.end()) {
+    rpc::Expression expr;
+    expr.compile(str);
+
+    if (cache.size() >= max_size)
+      cache.clear();
+
+    itr = cache.insert(std::make_pair(str, expr)).first;
+  }
+
+  return itr->second.evaluate(target);
+}
+
 torrent::Object
 apply_to_time(int flags, const torrent::Object& rawArgs) {
   std::tm *u;
@@ -504,6 +534,8 @@ initialize_command_ui() {
   ADD_ANY_LIST("less",                  rak::ptr_fn(&apply_less));
   ADD_ANY_LIST("greater",               rak::ptr_fn(&apply_greater));
 
+  ADD_ANY_NONE("expr",                  rak::ptr_fn(&apply_expr));
+
   // A temporary command for handling stuff until we get proper
   // support for seperation of commands and literals.
   ADD_ANY_NONE("branch",                rak::bind_ptr_fn(&apply_if, 1));
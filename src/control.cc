@@ -40,17 +40,24 @@
 #include <sys/stat.h>
 #include <torrent/connection_manager.h>
 
+#include "core/bandwidth_controller.h"
 #include "core/manager.h"
 #include "core/download_store.h"
 #include "core/view_manager.h"
 #include "core/dht_manager.h"
+#include "core/metrics.h"
+#include "core/profiler.h"
+#include "core/queue_manager.h"
+#include "core/slot_allocator.h"
 
 #include "display/canvas.h"
 #include "display/window.h"
 #include "display/manager.h"
 #include "input/manager.h"
 #include "input/input_event.h"
+#include "rpc/capture_replay.h"
 #include "rpc/command_scheduler.h"
+#include "rpc/event_stream.h"
 #include "rpc/parse_commands.h"
 #include "rpc/scgi.h"
 #include "ui/root.h"
@@ -67,18 +74,26 @@ Control::Control() :
   m_inputStdin(new input::InputEvent(STDIN_FILENO)),
 
   m_commandScheduler(new rpc::CommandScheduler()),
+  m_captureReplay(new rpc::CaptureReplay()),
 
   m_scgi(NULL),
+  m_eventStream(NULL),
 
   m_tick(0) {
 
   m_core        = new core::Manager();
   m_viewManager = new core::ViewManager();
   m_dhtManager  = new core::DhtManager();
+  m_metrics     = new core::Metrics();
+  m_profiler    = new core::Profiler();
+  m_queueManager = new core::QueueManager();
+  m_bandwidthController = new core::BandwidthController();
+  m_slotAllocator = new core::SlotAllocator();
 
   m_inputStdin->slot_pressed(sigc::mem_fun(m_input, &input::Manager::pressed));
 
   m_taskShutdown.set_slot(rak::mem_fn(this, &Control::handle_shutdown));
+  m_taskShutdown.set_name("control.shutdown");
 
   m_commandScheduler->set_slot_error_message(rak::mem_fn(m_core, &core::Manager::push_log_std));
 }
@@ -88,6 +103,7 @@ Control::~Control() {
   delete m_input;
 
   delete m_commandScheduler;
+  delete m_captureReplay;
 
   delete m_viewManager;
 
@@ -95,6 +111,11 @@ Control::~Control() {
   delete m_display;
   delete m_core;
   delete m_dhtManager;
+  delete m_metrics;
+  delete m_profiler;
+  delete m_queueManager;
+  delete m_bandwidthController;
+  delete m_slotAllocator;
 }
 
 void
@@ -121,6 +142,7 @@ Control::initialize() {
 void
 Control::cleanup() {
   delete m_scgi; m_scgi = NULL;
+  delete m_eventStream; m_eventStream = NULL;
   rpc::xmlrpc.cleanup();
 
   priority_queue_erase(&taskScheduler, &m_taskShutdown);
@@ -141,6 +163,8 @@ Control::cleanup() {
 void
 Control::cleanup_exception() {
   delete m_scgi; m_scgi = NULL;
+  rpc::xmlrpc.workers()->stop();
+  delete m_eventStream; m_eventStream = NULL;
 
   display::Canvas::cleanup();
 }
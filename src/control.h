@@ -51,6 +51,11 @@ namespace core {
   class Manager;
   class ViewManager;
   class DhtManager;
+  class Metrics;
+  class Profiler;
+  class QueueManager;
+  class BandwidthController;
+  class SlotAllocator;
 }
 
 namespace display {
@@ -63,7 +68,9 @@ namespace input {
 }  
 
 namespace rpc {
+  class CaptureReplay;
   class CommandScheduler;
+  class EventStream;
   class FastCgi;
   class SCgi;
   class XmlRpc;
@@ -90,6 +97,11 @@ public:
   core::Manager*      core()                        { return m_core; }
   core::ViewManager*  view_manager()                { return m_viewManager; }
   core::DhtManager*   dht_manager()                 { return m_dhtManager; }
+  core::Metrics*      metrics()                     { return m_metrics; }
+  core::Profiler*     profiler()                    { return m_profiler; }
+  core::QueueManager* queue_manager()               { return m_queueManager; }
+  core::BandwidthController* bandwidth_controller() { return m_bandwidthController; }
+  core::SlotAllocator* slot_allocator()             { return m_slotAllocator; }
 
 
   ui::Root*           ui()                          { return m_ui; }
@@ -102,6 +114,11 @@ public:
   rpc::SCgi*          scgi()                        { return m_scgi; }
   void                set_scgi(rpc::SCgi* f)        { m_scgi = f; }
 
+  rpc::CaptureReplay* capture_replay()              { return m_captureReplay; }
+
+  rpc::EventStream*   event_stream()                { return m_eventStream; }
+  void                set_event_stream(rpc::EventStream* s) { m_eventStream = s; }
+
   uint64_t            tick() const                  { return m_tick; }
   void                inc_tick()                    { m_tick++; }
 
@@ -118,6 +135,11 @@ private:
   core::Manager*      m_core;
   core::ViewManager*  m_viewManager;
   core::DhtManager*   m_dhtManager;
+  core::Metrics*      m_metrics;
+  core::Profiler*     m_profiler;
+  core::QueueManager* m_queueManager;
+  core::BandwidthController* m_bandwidthController;
+  core::SlotAllocator* m_slotAllocator;
 
   ui::Root*           m_ui;
   display::Manager*   m_display;
@@ -125,8 +147,10 @@ private:
   input::InputEvent*  m_inputStdin;
 
   rpc::CommandScheduler* m_commandScheduler;
+  rpc::CaptureReplay* m_captureReplay;
 
   rpc::SCgi*          m_scgi;
+  rpc::EventStream*   m_eventStream;
 
   uint64_t            m_tick;
 
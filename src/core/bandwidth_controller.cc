@@ -0,0 +1,295 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <rak/priority_queue_default.h>
+#include <torrent/exceptions.h>
+#include <torrent/object.h>
+#include <torrent/rate.h>
+#include <torrent/torrent.h>
+
+#include "rpc/parse_commands.h"
+
+#include "globals.h"
+#include "control.h"
+#include "bandwidth_controller.h"
+#include "download.h"
+#include "download_list.h"
+#include "manager.h"
+#include "queue_manager.h"
+#include "view.h"
+#include "view_manager.h"
+
+namespace core {
+
+static const char*
+bandwidth_controller_state(int state) {
+  switch (state) {
+  case BandwidthController::state_saturated: return "saturated";
+  case BandwidthController::state_headroom:  return "headroom";
+  default:                                   return "steady";
+  }
+}
+
+BandwidthController::BandwidthController() :
+  m_interval(0),
+  m_downCapacity(0),
+  m_upCapacity(0),
+  m_lowWatermark(75),
+  m_highWatermark(95),
+  m_minRuntime(300),
+  m_maxActive(-1),
+  m_downState(state_steady),
+  m_upState(state_steady),
+  m_started(0),
+  m_paused(0) {
+
+  m_task.set_slot(rak::mem_fn(this, &BandwidthController::receive_tick));
+  m_task.set_name("scheduler.bandwidth");
+}
+
+BandwidthController::~BandwidthController() {
+  priority_queue_erase(&taskScheduler, &m_task);
+}
+
+void
+BandwidthController::set_interval(int64_t v) {
+  if (v < 0)
+    throw torrent::input_error("Invalid interval.");
+
+  if (v == 0 && m_interval != 0)
+    release_held();
+
+  m_interval = v;
+  m_downState = state_steady;
+  m_upState = state_steady;
+
+  priority_queue_erase(&taskScheduler, &m_task);
+
+  if (m_interval != 0)
+    priority_queue_insert(&taskScheduler, &m_task, (cachedTime + rak::timer::from_seconds(m_interval)).round_seconds());
+}
+
+void
+BandwidthController::set_low_watermark(int64_t v) {
+  if (v < 0 || v > m_highWatermark)
+    throw torrent::input_error("Low watermark must be between 0 and the high watermark.");
+
+  m_lowWatermark = v;
+}
+
+void
+BandwidthController::set_high_watermark(int64_t v) {
+  if (v < m_lowWatermark || v > 100)
+    throw torrent::input_error("High watermark must be between the low watermark and 100.");
+
+  m_highWatermark = v;
+}
+
+torrent::Object
+BandwidthController::status() const {
+  torrent::Object result = torrent::Object::create_map();
+
+  result.insert_key("enabled",       (int64_t)is_enabled());
+  result.insert_key("down_rate",     (int64_t)torrent::down_rate()->rate());
+  result.insert_key("up_rate",       (int64_t)torrent::up_rate()->rate());
+  result.insert_key("down_capacity", m_downCapacity);
+  result.insert_key("up_capacity",   m_upCapacity);
+  result.insert_key("down_state",    std::string(bandwidth_controller_state(m_downState)));
+  result.insert_key("up_state",      std::string(bandwidth_controller_state(m_upState)));
+  result.insert_key("started",       (int64_t)m_started);
+  result.insert_key("paused",        (int64_t)m_paused);
+  result.insert_key("max_active",    m_maxActive);
+  result.insert_key("held",          (int64_t)m_held.size());
+  result.insert_key("last_action",   m_lastAction.seconds());
+
+  return result;
+}
+
+void
+BandwidthController::receive_tick() {
+  if (control->is_shutdown_started())
+    return;
+
+  prune_held();
+
+  adjust(false, classify(torrent::down_rate()->rate(), m_downCapacity), &m_downState);
+  adjust(true,  classify(torrent::up_rate()->rate(), m_upCapacity), &m_upState);
+
+  priority_queue_insert(&taskScheduler, &m_task, (cachedTime + rak::timer::from_seconds(m_interval)).round_seconds());
+}
+
+int
+BandwidthController::classify(uint32_t rate, int64_t capacity) const {
+  if (capacity <= 0)
+    return state_steady;
+
+  if ((int64_t)rate * 100 < capacity * m_lowWatermark)
+    return state_headroom;
+
+  if ((int64_t)rate * 100 > capacity * m_highWatermark)
+    return state_saturated;
+
+  return state_steady;
+}
+
+bool
+BandwidthController::adjust(bool seeding, int state, int* lastState) {
+  int previous = *lastState;
+  *lastState = state;
+
+  if (state == state_steady || state != previous)
+    return false;
+
+  Download* download = state == state_headroom ? find_waiting(seeding) : find_slowest(seeding);
+
+  if (download == NULL)
+    return false;
+
+  if (state == state_headroom) {
+    m_held.erase(download);
+    control->core()->download_list()->resume(download);
+    m_started++;
+
+  } else {
+    m_held.insert(download);
+    control->core()->download_list()->pause(download);
+    m_paused++;
+  }
+
+  // Wait for the state to be seen on two more ticks, as the rates
+  // take a while to reflect the change.
+  *lastState = state_steady;
+  m_lastAction = cachedTime;
+
+  return true;
+}
+
+// Forget held downloads that were resumed by someone else or left
+// the 'started' view, without dereferencing erased ones.
+void
+BandwidthController::prune_held() {
+  ViewManager::iterator viewItr = control->view_manager()->find("started");
+  download_set held;
+
+  if (viewItr != control->view_manager()->end())
+    for (View::iterator itr = (*viewItr)->begin_visible(), last = (*viewItr)->end_visible(); itr != last; itr++)
+      if (!(*itr)->is_active() && m_held.find(*itr) != m_held.end())
+        held.insert(*itr);
+
+  m_held.swap(held);
+}
+
+void
+BandwidthController::release_held() {
+  prune_held();
+
+  download_set held;
+  held.swap(m_held);
+
+  for (download_set::const_iterator itr = held.begin(), last = held.end(); itr != last; itr++)
+    control->core()->download_list()->resume(*itr);
+}
+
+// The inactive download that has been stopped for the longest time,
+// skipping downloads paused by hand or owned by the queue manager, if
+// 'max_active' allows another one to run.
+Download*
+BandwidthController::find_waiting(bool seeding) {
+  ViewManager::iterator viewItr = control->view_manager()->find("started");
+
+  if (viewItr == control->view_manager()->end())
+    return NULL;
+
+  Download* result = NULL;
+  int64_t resultChanged = 0;
+  int64_t numActive = 0;
+
+  for (View::iterator itr = (*viewItr)->begin_visible(), last = (*viewItr)->end_visible(); itr != last; itr++) {
+    if ((*itr)->is_active()) {
+      numActive++;
+      continue;
+    }
+
+    if ((*itr)->is_hash_failed() || (*itr)->is_done() != seeding || control->queue_manager()->is_queued(*itr) ||
+        rpc::call_command_value("d.get_paused", rpc::make_target(*itr)) ||
+        rpc::call_command_value("d.get_hashing", rpc::make_target(*itr)) != Download::variable_hashing_stopped)
+      continue;
+
+    int64_t changed = rpc::call_command_value("d.get_state_changed", rpc::make_target(*itr));
+
+    if (result == NULL || changed < resultChanged) {
+      result = *itr;
+      resultChanged = changed;
+    }
+  }
+
+  if (m_maxActive >= 0 && numActive >= m_maxActive)
+    return NULL;
+
+  return result;
+}
+
+// The slowest active download that has been running for at least
+// 'min_runtime' seconds and isn't owned by the queue manager.
+Download*
+BandwidthController::find_slowest(bool seeding) {
+  ViewManager::iterator viewItr = control->view_manager()->find("started");
+
+  if (viewItr == control->view_manager()->end())
+    return NULL;
+
+  Download* result = NULL;
+  uint32_t resultRate = 0;
+
+  for (View::iterator itr = (*viewItr)->begin_visible(), last = (*viewItr)->end_visible(); itr != last; itr++) {
+    if (!(*itr)->is_active() || (*itr)->is_done() != seeding || control->queue_manager()->is_queued(*itr) ||
+        cachedTime.seconds() - rpc::call_command_value("d.get_state_changed", rpc::make_target(*itr)) < m_minRuntime)
+      continue;
+
+    uint32_t rate = seeding ? (*itr)->download()->up_rate()->rate() : (*itr)->download()->down_rate()->rate();
+
+    if (result == NULL || rate < resultRate) {
+      result = *itr;
+      resultRate = rate;
+    }
+  }
+
+  return result;
+}
+
+}
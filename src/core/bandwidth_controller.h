@@ -0,0 +1,149 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_CORE_BANDWIDTH_CONTROLLER_H
+#define RTORRENT_CORE_BANDWIDTH_CONTROLLER_H
+
+#include <set>
+#include <inttypes.h>
+#include <rak/priority_queue_default.h>
+#include <rak/timer.h>
+
+namespace torrent {
+  class Object;
+}
+
+namespace core {
+
+class Download;
+
+// Starts and pauses downloads in the 'started' view to keep the link
+// busy without saturating it. Every 'interval' seconds the global
+// rates are compared against the configured capacity; below the low
+// watermark the inactive download that has waited the longest is
+// started, above the high watermark the slowest one is paused.
+// Downloads paused by hand, marked by 'd.get_paused', are never
+// started, downloads owned by the queue manager are left alone, and
+// no more than 'max_active' downloads in the view are kept running.
+// Disabling the controller resumes the downloads it paused.
+// Incomplete downloads are controlled by the download rate and
+// complete ones by the upload rate, and a zero capacity leaves that
+// side alone.
+//
+// A state has to be seen on two ticks in a row before acting on it,
+// and downloads are not paused before they have been running for
+// 'min_runtime' seconds, so that new downloads get a chance to ramp
+// up.
+
+class BandwidthController {
+public:
+  static const int state_saturated = -1;
+  static const int state_steady    = 0;
+  static const int state_headroom  = 1;
+
+  BandwidthController();
+  ~BandwidthController();
+
+  bool                is_enabled() const                  { return m_task.is_queued(); }
+
+  // Seconds between each check, zero disables the controller.
+  int64_t             interval() const                    { return m_interval; }
+  void                set_interval(int64_t v);
+
+  int64_t             down_capacity() const               { return m_downCapacity; }
+  void                set_down_capacity(int64_t v)        { m_downCapacity = v; }
+
+  int64_t             up_capacity() const                 { return m_upCapacity; }
+  void                set_up_capacity(int64_t v)          { m_upCapacity = v; }
+
+  // Percent of capacity.
+  int64_t             low_watermark() const               { return m_lowWatermark; }
+  void                set_low_watermark(int64_t v);
+
+  int64_t             high_watermark() const              { return m_highWatermark; }
+  void                set_high_watermark(int64_t v);
+
+  int64_t             min_runtime() const                 { return m_minRuntime; }
+  void                set_min_runtime(int64_t v)          { m_minRuntime = v; }
+
+  // Upper bound on running downloads in the 'started' view, negative
+  // for no limit.
+  int64_t             max_active() const                  { return m_maxActive; }
+  void                set_max_active(int64_t v)           { m_maxActive = v; }
+
+  torrent::Object     status() const;
+
+private:
+  typedef std::set<Download*> download_set;
+
+  BandwidthController(const BandwidthController&);
+  void operator = (const BandwidthController&);
+
+  void                receive_tick();
+
+  int                 classify(uint32_t rate, int64_t capacity) const;
+  bool                adjust(bool seeding, int state, int* lastState);
+
+  void                prune_held();
+  void                release_held();
+
+  Download*           find_waiting(bool seeding);
+  Download*           find_slowest(bool seeding);
+
+  rak::priority_item  m_task;
+
+  int64_t             m_interval;
+  int64_t             m_downCapacity;
+  int64_t             m_upCapacity;
+  int64_t             m_lowWatermark;
+  int64_t             m_highWatermark;
+  int64_t             m_minRuntime;
+  int64_t             m_maxActive;
+
+  int                 m_downState;
+  int                 m_upState;
+
+  uint64_t            m_started;
+  uint64_t            m_paused;
+  rak::timer          m_lastAction;
+
+  // Downloads paused by the controller that are still waiting.
+  download_set        m_held;
+};
+
+}
+
+#endif
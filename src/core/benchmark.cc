@@ -0,0 +1,323 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include <unistd.h>
+#include <rak/path.h>
+#include <rak/priority_queue_default.h>
+#include <torrent/exceptions.h>
+#include <torrent/object.h>
+
+#include "rpc/expression.h"
+#include "rpc/parse_commands.h"
+
+#include "globals.h"
+#include "control.h"
+#include "benchmark.h"
+#include "download.h"
+#include "download_list.h"
+#include "download_store.h"
+#include "manager.h"
+#include "view.h"
+#include "view_manager.h"
+
+namespace core {
+
+const char* benchmark_cases[] = {
+  "command_lookup",
+  "priority_queue",
+  "view_sort",
+  "view_filter",
+  "filter_command",
+  "filter_expression",
+  "d_multicall",
+  "xmlrpc",
+  NULL
+};
+
+static const unsigned int benchmark_queue_size = 1024;
+
+static const char benchmark_xmlrpc_request[] =
+  "<?xml version=\"1.0\"?><methodCall><methodName>d.multicall</methodName><params>"
+  "<param><value><string>main</string></value></param>"
+  "<param><value><string>d.get_hash=</string></value></param>"
+  "<param><value><string>d.get_name=</string></value></param>"
+  "<param><value><string>d.get_completed_bytes=</string></value></param>"
+  "</params></methodCall>";
+
+static void
+benchmark_noop() {
+}
+
+static bool
+benchmark_discard(const char*, uint32_t) {
+  return true;
+}
+
+static View*
+benchmark_view() {
+  ViewManager::iterator itr = control->view_manager()->find("main");
+
+  if (itr == control->view_manager()->end())
+    throw torrent::input_error("Could not find view.");
+
+  return *itr;
+}
+
+static uint64_t
+benchmark_command_lookup(uint32_t iterations) {
+  uint64_t operations = 0;
+
+  for (uint32_t i = 0; i != iterations; ++i)
+    for (rpc::CommandMap::const_iterator itr = rpc::commands.begin(), last = rpc::commands.end(); itr != last; ++itr, ++operations)
+      if (rpc::commands.find(itr->first) == last)
+        throw torrent::internal_error("benchmark_command_lookup() lookup failed.");
+
+  return operations;
+}
+
+static uint64_t
+benchmark_priority_queue(uint32_t iterations) {
+  rak::priority_queue_default queue;
+  rak::priority_item          items[benchmark_queue_size];
+
+  for (unsigned int j = 0; j != benchmark_queue_size; ++j)
+    items[j].set_slot(rak::ptr_fn(&benchmark_noop));
+
+  for (uint32_t i = 0; i != iterations; ++i) {
+    // Spread the insertion times so the heap actually reorders.
+    for (unsigned int j = 0; j != benchmark_queue_size; ++j)
+      rak::priority_queue_insert(&queue, &items[j], cachedTime + rak::timer((j * 7919) % benchmark_queue_size + 1));
+
+    for (unsigned int j = 0; j != benchmark_queue_size; j += 2)
+      rak::priority_queue_erase(&queue, &items[j]);
+
+    rak::priority_queue_perform(&queue, rak::timer::max());
+  }
+
+  return (uint64_t)iterations * benchmark_queue_size;
+}
+
+// The same condition written as a command string and as an
+// expression, evaluated for every download in the view.
+static uint64_t
+benchmark_filter(uint32_t iterations, bool expression) {
+  View* view = benchmark_view();
+
+  std::string command = "and={d.get_complete=,d.is_open=}";
+  rpc::Expression expr;
+  expr.compile("d.get_complete && d.is_open");
+
+  for (uint32_t i = 0; i != iterations; ++i)
+    for (View::iterator itr = view->begin_visible(), last = view->end_filtered(); itr != last; ++itr)
+      if (expression)
+        expr.evaluate_bool(rpc::make_target(*itr));
+      else
+        rpc::parse_command_single(rpc::make_target(*itr), command);
+
+  return (uint64_t)iterations * std::distance(view->begin_visible(), view->end_filtered());
+}
+
+static uint64_t
+benchmark_d_multicall(uint32_t iterations) {
+  torrent::Object args = torrent::Object::create_list();
+  args.as_list().push_back("main");
+  args.as_list().push_back("d.get_hash=");
+  args.as_list().push_back("d.get_name=");
+  args.as_list().push_back("d.get_completed_bytes=");
+
+  uint64_t operations = 0;
+
+  for (uint32_t i = 0; i != iterations; ++i)
+    operations += rpc::commands.call("d.multicall", args).as_list().size();
+
+  return operations;
+}
+
+static uint64_t
+benchmark_xmlrpc(uint32_t iterations) {
+  if (!rpc::xmlrpc.is_valid())
+    throw torrent::input_error("XMLRPC is not initialized.");
+
+  rpc::XmlRpc::slot_write slotWrite;
+  slotWrite.set(rak::ptr_fn(&benchmark_discard));
+
+  for (uint32_t i = 0; i != iterations; ++i)
+    rpc::xmlrpc.process_uncached(benchmark_xmlrpc_request, sizeof(benchmark_xmlrpc_request) - 1, slotWrite);
+
+  return iterations;
+}
+
+// Saves the downloads to a temporary session directory, which is
+// removed afterwards. Each download's metainfo is written on the first
+// iteration, as for a new session directory, and after that only the
+// state files.
+static uint64_t
+benchmark_session_save(uint32_t iterations) {
+  const char* tmpdir = std::getenv("TMPDIR");
+  std::string path = std::string(tmpdir != NULL && *tmpdir != '\0' ? tmpdir : "/tmp") + "/rtorrent-bench.XXXXXX";
+
+  if (::mkdtemp(&*path.begin()) == NULL)
+    throw torrent::input_error("Could not create a temporary session directory.");
+
+  DownloadList* downloadList = control->core()->download_list();
+  std::vector<std::string> metainfoPaths;
+
+  for (DownloadList::iterator itr = downloadList->begin(), last = downloadList->end(); itr != last; ++itr)
+    metainfoPaths.push_back((*itr)->metainfo_path());
+
+  DownloadStore store;
+  store.set_path(path);
+  store.enable(false);
+
+  for (uint32_t i = 0; i != iterations; ++i)
+    std::for_each(downloadList->begin(), downloadList->end(), std::bind1st(std::mem_fun(&DownloadStore::save), &store));
+
+  // Saving may have released the piece hashes, get them back before
+  // the files are removed and point the downloads at their real
+  // session directory again.
+  std::vector<std::string>::iterator pathItr = metainfoPaths.begin();
+
+  for (DownloadList::iterator itr = downloadList->begin(), last = downloadList->end(); itr != last; ++itr, ++pathItr) {
+    store.restore_metainfo(*itr);
+    store.remove(*itr);
+
+    (*itr)->set_metainfo_path(*pathItr);
+  }
+
+  store.disable();
+  ::rmdir(path.c_str());
+
+  return (uint64_t)iterations * downloadList->size();
+}
+
+benchmark_result
+benchmark_run(const std::string& name, uint32_t iterations) {
+  if (iterations == 0)
+    throw torrent::input_error("Invalid number of iterations.");
+
+  benchmark_result result;
+  rak::timer start = rak::timer::current();
+
+  if (name == "command_lookup") {
+    result.m_operations = benchmark_command_lookup(iterations);
+
+  } else if (name == "priority_queue") {
+    result.m_operations = benchmark_priority_queue(iterations);
+
+  } else if (name == "view_sort") {
+    View* view = benchmark_view();
+
+    for (uint32_t i = 0; i != iterations; ++i)
+      view->sort();
+
+    result.m_operations = (uint64_t)iterations * view->size();
+
+  } else if (name == "view_filter") {
+    View* view = benchmark_view();
+
+    for (uint32_t i = 0; i != iterations; ++i)
+      view->filter();
+
+    result.m_operations = (uint64_t)iterations * view->size();
+
+  } else if (name == "filter_command") {
+    result.m_operations = benchmark_filter(iterations, false);
+
+  } else if (name == "filter_expression") {
+    result.m_operations = benchmark_filter(iterations, true);
+
+  } else if (name == "d_multicall") {
+    result.m_operations = benchmark_d_multicall(iterations);
+
+  } else if (name == "xmlrpc") {
+    result.m_operations = benchmark_xmlrpc(iterations);
+
+  } else if (name == "session_save") {
+    result.m_operations = benchmark_session_save(iterations);
+
+  } else {
+    throw torrent::input_error("Unknown benchmark.");
+  }
+
+  result.m_usec = (rak::timer::current() - start).usec();
+  return result;
+}
+
+void
+benchmark_dump(const std::string& filename, uint32_t iterations) {
+  std::fstream output(rak::path_expand(filename).c_str(), std::ios::out | std::ios::trunc);
+
+  if (!output.is_open())
+    throw torrent::input_error("Could not open benchmark output file.");
+
+  output << "{\"downloads\":" << control->core()->download_list()->size()
+         << ",\"iterations\":" << iterations
+         << ",\"cases\":{";
+
+  for (const char** name = benchmark_cases; *name != NULL; ++name) {
+    if (name != benchmark_cases)
+      output << ',';
+
+    output << '"' << *name << "\":";
+
+    try {
+      benchmark_result result = benchmark_run(*name, iterations);
+
+      output << "{\"operations\":" << result.m_operations
+             << ",\"usec\":" << result.m_usec
+             << ",\"nsec_per_op\":" << (result.m_operations != 0 ? result.m_usec * 1000 / (int64_t)result.m_operations : 0)
+             << '}';
+
+    } catch (torrent::input_error&) {
+      output << "null";
+    }
+  }
+
+  output << "}}\n";
+
+  if (!output.good())
+    throw torrent::input_error("Could not write benchmark output file.");
+}
+
+}
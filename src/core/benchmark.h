@@ -0,0 +1,69 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_CORE_BENCHMARK_H
+#define RTORRENT_CORE_BENCHMARK_H
+
+#include <string>
+#include <inttypes.h>
+
+namespace core {
+
+// Micro-benchmarks of the client's hot paths, run against the live
+// download list and views so the numbers reflect real data. The
+// "xmlrpc" case bypasses the response cache and capture log. The
+// "session_save" case writes every download to a temporary session
+// directory, so it isn't in 'benchmark_cases' and has to be named
+// explicitly.
+
+struct benchmark_result {
+  benchmark_result() : m_operations(0), m_usec(0) {}
+
+  uint64_t            m_operations;
+  int64_t             m_usec;
+};
+
+extern const char* benchmark_cases[];
+
+benchmark_result benchmark_run(const std::string& name, uint32_t iterations);
+
+// Run every case in 'benchmark_cases' and write the results to
+// 'filename' as a JSON object.
+void             benchmark_dump(const std::string& filename, uint32_t iterations);
+
+}
+
+#endif
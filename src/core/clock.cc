@@ -0,0 +1,105 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <string>
+#include <torrent/exceptions.h>
+#include <torrent/object.h>
+
+#include "globals.h"
+#include "clock.h"
+
+namespace core {
+
+torrent::Object
+Clock::simulate(rak::priority_queue_default* queue, rak::timer duration) {
+  if (duration <= 0)
+    throw torrent::input_error("Invalid simulation duration.");
+
+  m_time = cachedTime;
+
+  rak::timer end = m_time + duration;
+  rak::timer realStart = rak::timer::current();
+
+  torrent::Object resultRaw = torrent::Object::create_map();
+  torrent::Object& tasks = resultRaw.insert_key("tasks", torrent::Object::create_map());
+  int64_t calls = 0;
+
+  while (!queue->empty() && queue->top()->time() <= end) {
+    rak::priority_item* v = queue->top();
+    queue->pop();
+
+    m_time = std::max(m_time, v->time());
+    cachedTime = m_time;
+
+    v->clear_time();
+
+    // Keep a copy of the name as the task may delete itself.
+    std::string name = v->name() != NULL ? v->name() : "unnamed";
+    rak::timer start = rak::timer::current();
+
+    v->call();
+
+    int64_t usec = (rak::timer::current() - start).usec();
+    torrent::Object& entry = tasks.has_key(name) ? tasks.get_key(name) : tasks.insert_key(name, torrent::Object::create_map());
+
+    if (entry.has_key_value("calls")) {
+      entry.get_key("calls").as_value()++;
+      entry.get_key("usec").as_value() += usec;
+      entry.get_key("max_usec").as_value() = std::max(entry.get_key("max_usec").as_value(), usec);
+
+    } else {
+      entry.insert_key("calls", (int64_t)1);
+      entry.insert_key("usec", usec);
+      entry.insert_key("max_usec", usec);
+    }
+
+    calls++;
+  }
+
+  m_time = end;
+  cachedTime = m_time;
+
+  resultRaw.insert_key("calls", calls);
+  resultRaw.insert_key("simulated_usec", duration.usec());
+  resultRaw.insert_key("usec", (rak::timer::current() - realStart).usec());
+
+  return resultRaw;
+}
+
+}
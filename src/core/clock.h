@@ -0,0 +1,75 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_CORE_CLOCK_H
+#define RTORRENT_CORE_CLOCK_H
+
+#include <inttypes.h>
+#include <rak/priority_queue_default.h>
+#include <rak/timer.h>
+
+namespace torrent {
+  class Object;
+}
+
+namespace core {
+
+// Simulated clock used by the '-S' test mode. Time only moves when
+// the scheduler is driven, jumping straight to the next due task
+// instead of waiting for it, so a day of scheduled work can be run in
+// seconds.
+//
+// The client exits after a simulation as 'cachedTime' is left at the
+// simulated end time; the live main loop always reads the system
+// clock. Libtorrent keeps its own clock and is not affected.
+
+class Clock {
+public:
+  rak::timer          current() const                 { return m_time; }
+
+  // Fast-forward the queue by 'duration' from 'cachedTime', calling
+  // every task that becomes due at its scheduled time. Returns a map
+  // with the number of calls and the wall-clock time spent per task
+  // name.
+  torrent::Object     simulate(rak::priority_queue_default* queue, rak::timer duration);
+
+private:
+  rak::timer          m_time;
+};
+
+}
+
+#endif
@@ -112,6 +112,7 @@ DhtManager::start_dht() {
     torrent::dht_manager()->reset_statistics();
 
     m_updateTimeout.set_slot(rak::mem_fn(this, &DhtManager::update));
+    m_updateTimeout.set_name("dht.update");
     priority_queue_insert(&taskScheduler, &m_updateTimeout, (cachedTime + rak::timer::from_seconds(60)).round_seconds());
 
     m_dhtPrevCycle = 0;
@@ -195,6 +196,7 @@ DhtManager::update() {
       
     if (itr == end) {
       m_stopTimeout.set_slot(rak::mem_fn(this, &DhtManager::stop_dht));
+      m_stopTimeout.set_name("dht.stop");
       priority_queue_insert(&taskScheduler, &m_stopTimeout, (cachedTime + rak::timer::from_seconds(15 * 60)).round_seconds());
     }
   }
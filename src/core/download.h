@@ -37,7 +37,9 @@
 #ifndef RTORRENT_CORE_DOWNLOAD_H
 #define RTORRENT_CORE_DOWNLOAD_H
 
+#include <map>
 #include <sigc++/connection.h>
+#include <torrent/object.h>
 #include <torrent/download.h>
 #include <torrent/hash_string.h>
 #include <torrent/tracker_list.h>
@@ -115,6 +117,14 @@ public:
   uint32_t            resume_flags()                           { return m_resumeFlags; }
   void                set_resume_flags(uint32_t flags)         { m_resumeFlags = flags; }
 
+  // The session directory holding a metainfo-only copy of this
+  // torrent. DownloadStore only needs to save the state file as long
+  // as that is still its path.
+  bool                is_metainfo_stored(const std::string& path) const { return !m_metainfoPath.empty() && m_metainfoPath == path; }
+
+  const std::string&  metainfo_path() const                    { return m_metainfoPath; }
+  void                set_metainfo_path(const std::string& path) { m_metainfoPath = path; }
+
   void                set_root_directory(const std::string& path);
 
   void                set_throttle_name(const std::string& throttleName);
@@ -123,6 +133,18 @@ public:
 
   float               distributed_copies() const;
 
+  // Change tracking for d.multicall.since. The generation is bumped
+  // on state transitions, while the column map holds the last seen
+  // value of each queried command and the generation it changed at.
+  typedef std::map<std::string, std::pair<uint64_t, torrent::Object> > column_map;
+
+  static const unsigned int max_columns = 64;
+
+  uint64_t            generation() const                       { return m_generation; }
+  void                set_generation(uint64_t g)               { m_generation = g; }
+
+  column_map&         columns()                                { return m_columns; }
+
 private:
   Download(const Download&);
   void operator () (const Download&);
@@ -141,6 +163,10 @@ private:
   uint32_t            m_chunksFailed;
 
   uint32_t            m_resumeFlags;
+  std::string         m_metainfoPath;
+
+  uint64_t            m_generation;
+  column_map          m_columns;
 
   sigc::connection    m_connTrackerSucceded;
   sigc::connection    m_connTrackerFailed;
@@ -82,6 +82,8 @@ DownloadFactory::DownloadFactory(Manager* m) :
 
   m_taskLoad.set_slot(rak::mem_fn(this, &DownloadFactory::receive_load));
   m_taskCommit.set_slot(rak::mem_fn(this, &DownloadFactory::receive_commit));
+  m_taskLoad.set_name("download.load");
+  m_taskCommit.set_name("download.commit");
 
   m_variables["connection_leech"] = rpc::call_command_void("get_connection_leech");
   m_variables["connection_seed"]  = rpc::call_command_void("get_connection_seed");
@@ -177,6 +179,12 @@ DownloadFactory::receive_success() {
 
   torrent::Object* root = download->bencode();
 
+  // Session torrents keep their mutable state in a separate file next
+  // to the metainfo.
+  if (m_session && m_isFile)
+    if (DownloadStore::load_state(rak::path_expand(m_uri), root))
+      download->set_metainfo_path(m_manager->download_store()->path());
+
   if (!m_session) {
     // We only allow session torrents to keep their
     // 'rtorrent/libtorrent' sections. The "fast_resume" section
@@ -341,6 +349,7 @@ DownloadFactory::initialize_rtorrent(Download* download, torrent::Object* rtorre
                               : std::string());
 
   rtorrent->insert_preserve_copy("ignore_commands", (int64_t)0);
+  rtorrent->insert_preserve_copy("paused", (int64_t)0);
   rtorrent->insert_preserve_copy("views", torrent::Object::create_list());
 
   rtorrent->insert_preserve_type("connection_leech", m_variables["connection_leech"]);
@@ -40,6 +40,7 @@
 #include <iosfwd>
 #include <list>
 #include <string>
+#include <inttypes.h>
 
 namespace torrent {
   class HashString;
@@ -74,7 +75,7 @@ public:
   using base_type::empty;
   using base_type::size;
 
-  DownloadList() { }
+  DownloadList() : m_generation(0) { }
 
   void                clear();
 
@@ -111,6 +112,10 @@ public:
 
   void                check_hash(Download* d);
 
+  // Monotonic counter used to tag changes for d.multicall.since.
+  uint64_t            generation() const          { return m_generation; }
+  uint64_t            next_generation()           { return ++m_generation; }
+
   enum {
     D_SLOTS_INSERT,
     D_SLOTS_ERASE,
@@ -161,6 +166,8 @@ private:
 
   void                received_finished(Download* d);
   void                confirm_finished(Download* d);
+
+  uint64_t            m_generation;
 };
 
 }
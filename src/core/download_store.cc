@@ -51,6 +51,7 @@
 #include <torrent/resume.h>
 #include <torrent/object_stream.h>
 
+#include "rpc/parse_commands.h"
 #include "utils/directory.h"
 
 #include "download.h"
@@ -98,50 +99,132 @@ DownloadStore::set_path(const std::string& path) {
     m_path = rak::path_expand(path);
 }
 
+// The keys that change during the lifetime of a download. These are
+// kept in '<hash>.rtorrent' while '<hash>.torrent' holds the metainfo,
+// which is only written once.
+static const char* download_store_state_keys[] = { "rtorrent", "libtorrent_resume", "libtorrent", NULL };
+
 bool
 DownloadStore::save(Download* d) {
   if (!is_enabled())
     return true;
 
-  std::fstream f((create_filename(d) + ".new").c_str(), std::ios::out | std::ios::trunc);
-
-  if (!f.is_open())
-    return false;
-
   // Move this somewhere else?
   d->bencode()->get_key("rtorrent").insert_key("total_uploaded", d->download()->up_rate()->total());
   d->bencode()->get_key("rtorrent").insert_key("chunks_done", d->download()->file_list()->completed_chunks());
 
-  torrent::Object tmp;
   torrent::Object& resumeObject = d->download()->bencode()->get_key("libtorrent_resume");
 
   torrent::resume_save_addresses(*d->download(), resumeObject);
   torrent::resume_save_file_priorities(*d->download(), resumeObject);
   torrent::resume_save_tracker_settings(*d->download(), resumeObject);
 
-  f << *d->bencode();
+  // Temporarily move the state keys out of the bencode, this avoids
+  // copying the metainfo when writing the two files separately.
+  torrent::Object state = torrent::Object::create_map();
 
-  if (!f.good())
-    goto download_store_save_error;
+  for (const char** key = download_store_state_keys; *key != NULL; ++key) {
+    if (!d->bencode()->has_key(*key))
+      continue;
 
-  f.close();
+    state.insert_key(*key, torrent::Object()).swap(d->bencode()->get_key(*key));
+    d->bencode()->erase_key(*key);
+  }
 
-  // Test the new file, to ensure it is a valid bencode string.
-  f.open((create_filename(d) + ".new").c_str(), std::ios::in);
+  // The state file is written first so that a session file still in
+  // the old format, with the state keys inline, is never replaced by
+  // a metainfo-only file before the state has been saved.
+  bool result = write_bencode(create_state_filename(d), state);
+
+  // The piece hashes may have been released after the metainfo was
+  // stored in a previous session directory, never write it without
+  // them.
+  if (result && !d->is_metainfo_stored(m_path)) {
+    result = restore_metainfo(d) && write_bencode(create_filename(m_path, d), *d->bencode());
+    d->set_metainfo_path(result ? m_path : std::string());
+  }
 
-  f >> tmp;
+  for (torrent::Object::map_type::iterator itr = state.as_map().begin(), last = state.as_map().end(); itr != last; ++itr)
+    d->bencode()->insert_key(itr->first, torrent::Object()).swap(itr->second);
 
-  if (!f.good())
-    goto download_store_save_error;
+  if (result)
+    release_metainfo(d);
 
-  f.close();
+  return result;
+}
+
+bool
+DownloadStore::load_state(const std::string& filename, torrent::Object* root) {
+  if (filename.size() < 8 || filename.substr(filename.size() - 8) != ".torrent")
+    return false;
+
+  std::fstream f((filename.substr(0, filename.size() - 8) + ".rtorrent").c_str(), std::ios::in | std::ios::binary);
 
-  ::rename((create_filename(d) + ".new").c_str(), create_filename(d).c_str());
+  if (!f.is_open())
+    return false;
+
+  torrent::Object state;
+  f >> state;
+
+  if (f.fail() || !state.is_map())
+    return false;
+
+  // Old session files keep the state keys inline, those still need
+  // to be replaced by a metainfo-only file on the next save.
+  bool inlined = false;
+
+  for (const char** key = download_store_state_keys; *key != NULL; ++key)
+    inlined = inlined || root->has_key(*key);
+
+  for (torrent::Object::map_type::iterator itr = state.as_map().begin(), last = state.as_map().end(); itr != last; ++itr)
+    root->insert_key(itr->first, torrent::Object()).swap(itr->second);
+
+  return !inlined;
+}
+
+// The 'info.pieces' string is only needed when the metainfo has to be
+// written again, or when hashing, so it may be dropped from memory once
+// the metainfo-only session file exists.
+bool
+DownloadStore::release_metainfo(Download* d) {
+  if (!is_enabled() || !d->is_metainfo_stored(m_path) ||
+      !rpc::call_command_value("get_metainfo.release") ||
+      rpc::call_command_value("d.get_hashing", rpc::make_target(d)) != Download::variable_hashing_stopped)
+    return false;
+
+  if (!d->bencode()->has_key_map("info"))
+    return false;
+
+  d->bencode()->get_key("info").erase_key("pieces");
   return true;
+}
 
-download_store_save_error:
-  f.close();
-  return false;
+bool
+DownloadStore::restore_metainfo(Download* d) {
+  if (!d->bencode()->has_key_map("info"))
+    return false;
+
+  torrent::Object& info = d->bencode()->get_key("info");
+
+  if (info.has_key_string("pieces"))
+    return true;
+
+  if (d->metainfo_path().empty())
+    return false;
+
+  std::fstream f(create_filename(d->metainfo_path(), d).c_str(), std::ios::in | std::ios::binary);
+
+  if (!f.is_open())
+    return false;
+
+  torrent::Object tmp;
+  f >> tmp;
+
+  if (f.fail() || !tmp.has_key_map("info") || !tmp.get_key("info").has_key_string("pieces"))
+    return false;
+
+  info.insert_key("pieces", torrent::Object()).swap(tmp.get_key("info").get_key("pieces"));
+  return true;
 }
 
 void
@@ -149,7 +232,8 @@ DownloadStore::remove(Download* d) {
   if (!is_enabled())
     return;
 
-  ::unlink(create_filename(d).c_str());
+  ::unlink(create_filename(m_path, d).c_str());
+  ::unlink(create_state_filename(d).c_str());
 }
 
 // This also needs to check that it isn't a directory.
@@ -186,9 +270,42 @@ DownloadStore::is_correct_format(const std::string& f) {
   return true;
 }
 
+bool
+DownloadStore::write_bencode(const std::string& filename, const torrent::Object& obj) {
+  std::fstream f((filename + ".new").c_str(), std::ios::out | std::ios::trunc);
+
+  if (!f.is_open())
+    return false;
+
+  f << obj;
+
+  if (!f.good())
+    return false;
+
+  f.close();
+
+  // Test the new file, to ensure it is a valid bencode string.
+  torrent::Object tmp;
+
+  f.open((filename + ".new").c_str(), std::ios::in);
+  f >> tmp;
+
+  if (!f.good())
+    return false;
+
+  f.close();
+
+  return ::rename((filename + ".new").c_str(), filename.c_str()) == 0;
+}
+
+std::string
+DownloadStore::create_filename(const std::string& path, Download* d) {
+  return path + rak::transform_hex(d->download()->info_hash().begin(), d->download()->info_hash().end()) + ".torrent";
+}
+
 std::string
-DownloadStore::create_filename(Download* d) {
-  return m_path + rak::transform_hex(d->download()->info_hash().begin(), d->download()->info_hash().end()) + ".torrent";
+DownloadStore::create_state_filename(Download* d) {
+  return m_path + rak::transform_hex(d->download()->info_hash().begin(), d->download()->info_hash().end()) + ".rtorrent";
 }
 
 }
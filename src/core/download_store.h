@@ -41,6 +41,10 @@
 
 #include "utils/lockfile.h"
 
+namespace torrent {
+  class Object;
+}
+
 namespace utils {
   class Directory;
 }
@@ -63,13 +67,26 @@ public:
   bool                save(Download* d);
   void                remove(Download* d);
 
+  // Drop and reload the piece hashes of a download's in-memory
+  // bencode, release only succeeds when 'metainfo.release' is set.
+  bool                release_metainfo(Download* d);
+  bool                restore_metainfo(Download* d);
+
+  // Merge the state file belonging to the session torrent 'filename'
+  // into 'root'. Returns true if 'filename' already was stored in the
+  // metainfo-only format.
+  static bool         load_state(const std::string& filename, torrent::Object* root);
+
   // Currently shows all entries in the correct format.
   utils::Directory    get_formated_entries();
 
   static bool         is_correct_format(const std::string& f);
 
 private:
-  std::string         create_filename(Download* d);
+  static bool         write_bencode(const std::string& filename, const torrent::Object& obj);
+
+  static std::string  create_filename(const std::string& path, Download* d);
+  std::string         create_state_filename(Download* d);
 
   std::string         m_path;
   utils::Lockfile     m_lockfile;
@@ -0,0 +1,187 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <torrent/exceptions.h>
+
+#include "ip_filter.h"
+
+namespace core {
+
+inline const char*
+skip_space(const char* first, const char* last) {
+  while (first != last && std::isspace(*first))
+    first++;
+
+  return first;
+}
+
+// Parse "a.b.c.d - e.f.g.h" with nothing but whitespace around it.
+inline bool
+parse_range(const char* first, const char* last, IpFilter::range_type* range) {
+  first = IpFilter::parse_address(skip_space(first, last), last, &range->first);
+
+  if (first == NULL || (first = skip_space(first, last)) == last || *first != '-')
+    return false;
+
+  first = IpFilter::parse_address(skip_space(first + 1, last), last, &range->second);
+
+  return first != NULL && skip_space(first, last) == last && range->first <= range->second;
+}
+
+const char*
+IpFilter::parse_address(const char* first, const char* last, uint32_t* address) {
+  *address = 0;
+
+  for (int i = 0; i < 4; i++) {
+    if (i != 0) {
+      if (first == last || *first != '.')
+        return NULL;
+
+      first++;
+    }
+
+    unsigned int octet = 0;
+    const char* start = first;
+
+    // Blocklists commonly zero-pad the octets, so don't treat a
+    // leading zero as octal like inet_aton would.
+    while (first != last && *first >= '0' && *first <= '9' && first - start < 3)
+      octet = octet * 10 + (*first++ - '0');
+
+    if (first == start || octet > 255)
+      return NULL;
+
+    *address = (*address << 8) | octet;
+  }
+
+  return first;
+}
+
+bool
+IpFilter::parse_line(const char* first, const char* last, range_type* range) {
+  first = skip_space(first, last);
+
+  if (first == last || *first == '#')
+    return false;
+
+  // P2P format, the description may itself contain ':' so use the
+  // last one.
+  const char* colon = std::find(std::reverse_iterator<const char*>(last), std::reverse_iterator<const char*>(first), ':').base();
+
+  if (colon != first && parse_range(colon, last, range))
+    return true;
+
+  // eMule format, entries with an access level above 127 are allowed
+  // through.
+  const char* comma = std::find(first, last, ',');
+
+  if (!parse_range(first, comma, range))
+    return false;
+
+  if (comma != last) {
+    const char* levelEnd = std::find(comma + 1, last, ',');
+    std::string level(skip_space(comma + 1, levelEnd), levelEnd);
+
+    if (!level.empty() && std::strtol(level.c_str(), NULL, 10) > 127)
+      return false;
+  }
+
+  return true;
+}
+
+void
+IpFilter::optimize() {
+  if (base_type::empty())
+    return;
+
+  std::sort(base_type::begin(), base_type::end());
+
+  iterator dest = base_type::begin();
+
+  for (iterator itr = dest + 1; itr != base_type::end(); ++itr) {
+    if (dest->second == ~uint32_t() || itr->first <= dest->second + 1)
+      dest->second = std::max(dest->second, itr->second);
+    else
+      *++dest = *itr;
+  }
+
+  base_type::erase(dest + 1, base_type::end());
+
+  // Drop the excess capacity, a freshly loaded list might otherwise
+  // hold on to quite a bit of unused memory.
+  base_type(*this).swap(*this);
+}
+
+bool
+IpFilter::is_filtered(uint32_t address) const {
+  // Find the first range starting after 'address', the one before it
+  // is the only candidate.
+  const_iterator itr = std::upper_bound(base_type::begin(), base_type::end(), range_type(address, ~uint32_t()));
+
+  return itr != base_type::begin() && address <= (--itr)->second;
+}
+
+unsigned int
+IpFilter::load(const std::string& filename) {
+  std::ifstream file(filename.c_str());
+
+  if (!file.is_open())
+    throw torrent::input_error("Could not open ip filter file: " + filename);
+
+  unsigned int count = 0;
+  std::string line;
+  range_type range;
+
+  while (std::getline(file, line)) {
+    if (!parse_line(line.c_str(), line.c_str() + line.size(), &range))
+      continue;
+
+    insert(range.first, range.second);
+    count++;
+  }
+
+  optimize();
+  return count;
+}
+
+}
@@ -0,0 +1,88 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_CORE_IP_FILTER_H
+#define RTORRENT_CORE_IP_FILTER_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+namespace core {
+
+// Sorted table of blocked IPv4 ranges, stored as inclusive host-order
+// [first, last] pairs so that the whole address space can be
+// represented. Lookups are a binary search on a flat array, which
+// keeps large blocklists cheap compared to one RangeMap node per
+// entry.
+//
+// Ranges are appended with 'insert' and the table must be 'optimize'd
+// before 'is_filtered' is called; 'load' does this itself.
+
+class IpFilter : private std::vector<std::pair<uint32_t, uint32_t> > {
+public:
+  typedef std::pair<uint32_t, uint32_t> range_type;
+  typedef std::vector<range_type>       base_type;
+
+  using base_type::const_iterator;
+  using base_type::begin;
+  using base_type::end;
+  using base_type::size;
+  using base_type::empty;
+  using base_type::clear;
+
+  void                swap(IpFilter& f)                       { base_type::swap(f); }
+
+  void                insert(uint32_t first, uint32_t last)   { base_type::push_back(range_type(first, last)); }
+
+  // Sort and merge overlapping or adjacent ranges.
+  void                optimize();
+
+  bool                is_filtered(uint32_t address) const;
+
+  // Parses a blocklist in the P2P plaintext format ("name:a.b.c.d-e.f.g.h")
+  // or the eMule ipfilter.dat format ("a.b.c.d - e.f.g.h , level , name"),
+  // ignoring blank lines and comments. Returns the number of ranges
+  // read, throws torrent::input_error if the file cannot be opened.
+  unsigned int        load(const std::string& filename);
+
+  static bool         parse_line(const char* first, const char* last, range_type* range);
+  static const char*  parse_address(const char* first, const char* last, uint32_t* address);
+};
+
+}
+
+#endif
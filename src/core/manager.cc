@@ -94,7 +94,7 @@ receive_tracker_dump(const std::string& url, const char* data, size_t size) {
 
 void
 Manager::handshake_log(const sockaddr* sa, int msg, int err, const torrent::HashString* hash) {
-  if (!rpc::call_command_value("get_handshake_log"))
+  if (!m_handshakeLog)
     return;
   
   std::string peer;
@@ -158,7 +158,8 @@ Manager::push_log(const char* msg) {
 }
 
 Manager::Manager() :
-  m_hashingView(NULL)
+  m_hashingView(NULL),
+  m_handshakeLog(false)
 //   m_pollManager(NULL) {
 {
   m_downloadStore   = new DownloadStore();
@@ -215,6 +216,42 @@ Manager::get_address_throttle(const sockaddr* addr) {
   return m_addressThrottles.get(rak::socket_address::cast_from(addr)->sa_inet()->address_h(), torrent::ThrottlePair(NULL, NULL));
 }
 
+void
+Manager::load_ip_filter(const std::string& filename) {
+  IpFilter ipFilter;
+  unsigned int count = ipFilter.load(filename);
+
+  // Only replace the active filter once the new one has been fully
+  // read, so a bad file leaves the old ranges in place.
+  m_ipFilter.swap(ipFilter);
+  torrent::connection_manager()->set_filter(sigc::mem_fun(this, &Manager::filter_address));
+
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "Loaded %u ip filter entries merged into %u ranges from '%s'.",
+           count, (unsigned int)m_ipFilter.size(), filename.c_str());
+  push_log(buffer);
+}
+
+void
+Manager::clear_ip_filter() {
+  m_ipFilter.clear();
+  torrent::connection_manager()->set_filter(torrent::ConnectionManager::slot_filter_type());
+}
+
+uint32_t
+Manager::filter_address(const sockaddr* addr) {
+  const rak::socket_address* socketAddress = rak::socket_address::cast_from(addr);
+
+  if (socketAddress->family() != rak::socket_address::af_inet ||
+      !m_ipFilter.is_filtered(socketAddress->sa_inet()->address_h()))
+    return 1;
+
+  if (m_handshakeLog)
+    m_logComplete.push_front("Filtered connection with " + socketAddress->address_str());
+
+  return 0;
+}
+
 // Most of this should be possible to move out.
 void
 Manager::initialize_second() {
@@ -43,6 +43,7 @@
 #include <torrent/connection_manager.h>
 
 #include "download_list.h"
+#include "ip_filter.h"
 #include "poll_manager.h"
 #include "range_map.h"
 #include "log.h"
@@ -95,6 +96,15 @@ public:
   void                  set_address_throttle(uint32_t begin, uint32_t end, torrent::ThrottlePair throttles);
   torrent::ThrottlePair get_address_throttle(const sockaddr* addr);
 
+  // Replaces the current ip filter with the ranges read from
+  // 'filename', connections to or from a filtered address are
+  // rejected by libtorrent.
+  const IpFilter&     ip_filter() const                   { return m_ipFilter; }
+  void                load_ip_filter(const std::string& filename);
+  void                clear_ip_filter();
+
+  uint32_t            filter_address(const sockaddr* addr);
+
   // Really should find a more descriptive name.
   void                initialize_second();
   void                cleanup();
@@ -116,6 +126,11 @@ public:
   void                push_log_std(const std::string& msg) { m_logImportant.push_front(msg); m_logComplete.push_front(msg); }
   void                push_log_complete(const std::string& msg) { m_logComplete.push_front(msg); }
 
+  // Cached so that the handshake and filter callbacks don't need a
+  // command lookup per connection.
+  bool                is_handshake_log() const            { return m_handshakeLog; }
+  void                set_handshake_log(bool v)           { m_handshakeLog = v; }
+
   void                handshake_log(const sockaddr* sa, int msg, int err, const torrent::HashString* hash);
 
   static const int create_start    = 0x1;
@@ -150,9 +165,12 @@ private:
 
   ThrottleMap         m_throttles;
   AddressThrottleMap  m_addressThrottles;
+  IpFilter            m_ipFilter;
 
   Log                 m_logImportant;
   Log                 m_logComplete;
+
+  bool                m_handshakeLog;
 };
 
 // Meh, cleanup.
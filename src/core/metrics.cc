@@ -0,0 +1,205 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <sstream>
+#include <rak/string_manip.h>
+#include <torrent/chunk_manager.h>
+#include <torrent/connection_manager.h>
+#include <torrent/dht_manager.h>
+#include <torrent/rate.h>
+#include <torrent/torrent.h>
+#include <torrent/data/file_list.h>
+
+#include "rpc/parse_commands.h"
+
+#include "globals.h"
+#include "control.h"
+#include "curl_stack.h"
+#include "download.h"
+#include "download_list.h"
+#include "manager.h"
+#include "metrics.h"
+#include "view_manager.h"
+
+namespace core {
+
+inline void
+metric_header(std::ostream& out, const char* name, const char* type, const char* help) {
+  out << "# HELP " << name << ' ' << help << '\n'
+      << "# TYPE " << name << ' ' << type << '\n';
+}
+
+inline void
+metric_value(std::ostream& out, const char* name, int64_t value) {
+  out << name << ' ' << value << '\n';
+}
+
+inline void
+metric(std::ostream& out, const char* name, const char* type, const char* help, int64_t value) {
+  metric_header(out, name, type, help);
+  metric_value(out, name, value);
+}
+
+// Label values may contain any characters, escape those with a
+// special meaning in the exposition format.
+std::string
+metric_label_escape(const std::string& src) {
+  std::string dest;
+  dest.reserve(src.size());
+
+  for (std::string::const_iterator itr = src.begin(); itr != src.end(); ++itr)
+    switch (*itr) {
+    case '\\': dest += "\\\\"; break;
+    case '"':  dest += "\\\""; break;
+    case '\n': dest += "\\n"; break;
+    default:   dest += *itr; break;
+    }
+
+  return dest;
+}
+
+std::string
+Metrics::render() {
+  int64_t interval = rpc::call_command_value("get_metrics.cache_interval");
+
+  if (!m_cache.empty() && cachedTime < m_lastRender + rak::timer::from_seconds(interval))
+    return m_cache;
+
+  m_cache.clear();
+  render_global(m_cache);
+
+  if (rpc::call_command_value("get_metrics.per_download"))
+    render_downloads(m_cache);
+
+  m_lastRender = cachedTime;
+  return m_cache;
+}
+
+void
+Metrics::render_global(std::string& dest) {
+  std::ostringstream out;
+
+  metric(out, "rtorrent_upload_bytes_per_second", "gauge", "Global upload rate in bytes per second.", torrent::up_rate()->rate());
+  metric(out, "rtorrent_download_bytes_per_second", "gauge", "Global download rate in bytes per second.", torrent::down_rate()->rate());
+  metric(out, "rtorrent_upload_bytes_total", "counter", "Total bytes uploaded.", torrent::up_rate()->total());
+  metric(out, "rtorrent_download_bytes_total", "counter", "Total bytes downloaded.", torrent::down_rate()->total());
+
+  metric(out, "rtorrent_memory_usage_bytes", "gauge", "Memory used by mapped chunks.", torrent::chunk_manager()->memory_usage());
+  metric(out, "rtorrent_memory_max_bytes", "gauge", "Maximum memory usage for mapped chunks.", torrent::chunk_manager()->max_memory_usage());
+
+  metric(out, "rtorrent_open_sockets", "gauge", "Open peer sockets.", torrent::connection_manager()->size());
+  metric(out, "rtorrent_max_open_sockets", "gauge", "Maximum number of open peer sockets.", torrent::connection_manager()->max_size());
+
+  metric(out, "rtorrent_http_active", "gauge", "Active HTTP transfers.", control->core()->http_stack()->active());
+  metric(out, "rtorrent_http_queued", "gauge", "HTTP transfers in the stack.", control->core()->http_stack()->size());
+
+  metric(out, "rtorrent_downloads", "gauge", "Number of loaded downloads.", control->core()->download_list()->size());
+
+  metric_header(out, "rtorrent_view_size", "gauge", "Number of visible downloads in each view.");
+
+  for (ViewManager::const_iterator itr = control->view_manager()->begin(), last = control->view_manager()->end(); itr != last; ++itr)
+    out << "rtorrent_view_size{view=\"" << metric_label_escape((*itr)->name()) << "\"} " << (*itr)->size_visible() << '\n';
+
+  metric(out, "rtorrent_dht_active", "gauge", "Whether the DHT node is running.", torrent::dht_manager()->is_active());
+
+  if (torrent::dht_manager()->is_active()) {
+    torrent::DhtManager::statistics_type stats = torrent::dht_manager()->get_statistics();
+
+    metric(out, "rtorrent_dht_nodes", "gauge", "Nodes in the DHT routing table.", stats.num_nodes);
+    metric(out, "rtorrent_dht_peers", "gauge", "Peers announced to this DHT node.", stats.num_peers);
+    metric(out, "rtorrent_dht_torrents", "gauge", "Torrents tracked by this DHT node.", stats.num_trackers);
+    metric(out, "rtorrent_dht_queries_received_total", "counter", "DHT queries received.", stats.queries_received);
+    metric(out, "rtorrent_dht_queries_sent_total", "counter", "DHT queries sent.", stats.queries_sent);
+    metric(out, "rtorrent_dht_replies_received_total", "counter", "DHT replies received.", stats.replies_received);
+    metric(out, "rtorrent_dht_read_bytes_total", "counter", "Bytes read by the DHT node.", stats.down_rate.total());
+    metric(out, "rtorrent_dht_written_bytes_total", "counter", "Bytes written by the DHT node.", stats.up_rate.total());
+  }
+
+  dest += out.str();
+}
+
+void
+Metrics::render_downloads(std::string& dest) {
+  static const int columns = 6;
+  static const char* names[columns] = {
+    "rtorrent_download_upload_bytes_per_second",
+    "rtorrent_download_download_bytes_per_second",
+    "rtorrent_download_upload_bytes_total",
+    "rtorrent_download_completed_bytes",
+    "rtorrent_download_size_bytes",
+    "rtorrent_download_peers_connected"
+  };
+  static const char* types[columns] = { "gauge", "gauge", "counter", "gauge", "gauge", "gauge" };
+  static const char* help[columns] = {
+    "Upload rate of the download in bytes per second.",
+    "Download rate of the download in bytes per second.",
+    "Total bytes uploaded for the download.",
+    "Completed bytes of the download.",
+    "Size of the download in bytes.",
+    "Connected peers of the download."
+  };
+
+  // Keep samples of a metric together, as the format requires.
+  std::ostringstream out[columns];
+
+  for (int i = 0; i < columns; i++)
+    metric_header(out[i], names[i], types[i], help[i]);
+
+  for (DownloadList::iterator itr = control->core()->download_list()->begin(), last = control->core()->download_list()->end(); itr != last; ++itr) {
+    const torrent::HashString& hash = (*itr)->download()->info_hash();
+    std::string labels = "{hash=\"" + rak::transform_hex(hash.begin(), hash.end()) +
+                         "\",name=\"" + metric_label_escape((*itr)->download()->name()) + "\"} ";
+
+    int64_t values[columns] = {
+      (*itr)->download()->up_rate()->rate(),
+      (*itr)->download()->down_rate()->rate(),
+      (*itr)->download()->up_rate()->total(),
+      (*itr)->file_list()->completed_bytes(),
+      (*itr)->file_list()->size_bytes(),
+      (*itr)->connection_list_size()
+    };
+
+    for (int i = 0; i < columns; i++)
+      out[i] << names[i] << labels << values[i] << '\n';
+  }
+
+  for (int i = 0; i < columns; i++)
+    dest += out[i].str();
+}
+
+}
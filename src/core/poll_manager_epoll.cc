@@ -43,7 +43,10 @@
 #include <torrent/poll_epoll.h>
 #include <torrent/torrent.h>
 
+#include "globals.h"
+#include "control.h"
 #include "poll_manager_epoll.h"
+#include "profiler.h"
 
 namespace core {
 
@@ -67,9 +70,17 @@ PollManagerEPoll::poll(rak::timer timeout) {
   torrent::perform();
   timeout = std::min(timeout, rak::timer(torrent::next_timeout())) + 1000;
 
-  if (static_cast<torrent::PollEPoll*>(m_poll)->poll((timeout.usec() + 999) / 1000) == -1)
+  int result;
+
+  {
+    ProfileScope profileScope(control->profiler(), "poll.wait");
+    result = static_cast<torrent::PollEPoll*>(m_poll)->poll((timeout.usec() + 999) / 1000);
+  }
+
+  if (result == -1)
     return check_error();
 
+  ProfileScope profileScope(control->profiler(), "poll.dispatch");
   torrent::perform();
   static_cast<torrent::PollEPoll*>(m_poll)->perform();
 }
@@ -44,7 +44,10 @@
 #include <torrent/poll_kqueue.h>
 #include <torrent/torrent.h>
 
+#include "globals.h"
+#include "control.h"
 #include "poll_manager_kqueue.h"
+#include "profiler.h"
 
 namespace core {
 
@@ -68,9 +71,17 @@ PollManagerKQueue::poll(rak::timer timeout) {
   torrent::perform();
   timeout = std::min(timeout, rak::timer(torrent::next_timeout())) + 1000;
 
-  if (static_cast<torrent::PollKQueue*>(m_poll)->poll((timeout.usec() + 999) / 1000) == -1)
+  int result;
+
+  {
+    ProfileScope profileScope(control->profiler(), "poll.wait");
+    result = static_cast<torrent::PollKQueue*>(m_poll)->poll((timeout.usec() + 999) / 1000);
+  }
+
+  if (result == -1)
     return check_error();
 
+  ProfileScope profileScope(control->profiler(), "poll.dispatch");
   torrent::perform();
   static_cast<torrent::PollKQueue*>(m_poll)->perform();
 }
@@ -43,7 +43,10 @@
 #include <torrent/poll_select.h>
 #include <torrent/torrent.h>
 
+#include "globals.h"
+#include "control.h"
 #include "poll_manager_select.h"
+#include "profiler.h"
 
 namespace core {
 
@@ -112,10 +115,17 @@ PollManagerSelect::poll(rak::timer timeout) {
   unsigned int maxFd = static_cast<torrent::PollSelect*>(m_poll)->fdset(m_readSet, m_writeSet, m_errorSet);
 
   timeval t = timeout.tval();
+  int result;
 
-  if (select(maxFd + 1, m_readSet, m_writeSet, m_errorSet, &t) == -1)
+  {
+    ProfileScope profileScope(control->profiler(), "poll.wait");
+    result = select(maxFd + 1, m_readSet, m_writeSet, m_errorSet, &t);
+  }
+
+  if (result == -1)
     return check_error();
 
+  ProfileScope profileScope(control->profiler(), "poll.dispatch");
   torrent::perform();
   static_cast<torrent::PollSelect*>(m_poll)->perform(m_readSet, m_writeSet, m_errorSet);
 }
@@ -0,0 +1,195 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <torrent/exceptions.h>
+#include <torrent/object.h>
+
+#include "profiler.h"
+
+namespace core {
+
+void
+ProfileHistogram::insert(uint64_t usec) {
+  unsigned int bucket = 0;
+
+  // Bucket 'n' holds samples in [2^(n-1), 2^n), with zero in the
+  // first bucket.
+  while (bucket < size_buckets - 1 && (usec >> bucket) != 0)
+    bucket++;
+
+  m_buckets[bucket]++;
+  m_count++;
+  m_total += usec;
+  m_max = std::max(m_max, usec);
+}
+
+uint64_t
+ProfileHistogram::percentile(unsigned int percent) const {
+  if (m_count == 0)
+    return 0;
+
+  uint64_t target = (m_count * percent + 99) / 100;
+  uint64_t seen = 0;
+
+  for (unsigned int bucket = 0; bucket != size_buckets; bucket++) {
+    if ((seen += m_buckets[bucket]) >= target)
+      return std::min(m_max, (uint64_t(1) << bucket) - 1);
+  }
+
+  return m_max;
+}
+
+Profiler::~Profiler() {
+  for (iterator itr = begin(), last = end(); itr != last; itr++)
+    std::free(const_cast<char*>(itr->first));
+
+  for (iterator itr = m_tasks.begin(), last = m_tasks.end(); itr != last; itr++)
+    std::free(const_cast<char*>(itr->first));
+}
+
+void
+Profiler::reset() {
+  for (iterator itr = begin(), last = end(); itr != last; itr++)
+    itr->second = ProfileHistogram();
+
+  for (iterator itr = m_tasks.begin(), last = m_tasks.end(); itr != last; itr++)
+    itr->second = ProfileHistogram();
+}
+
+ProfileHistogram*
+Profiler::find_histogram(base_type* histograms, const char* name) {
+  iterator itr = histograms->find(name);
+
+  if (itr == histograms->end())
+    itr = histograms->insert(value_type(strdup(name), ProfileHistogram())).first;
+
+  return &itr->second;
+}
+
+void
+Profiler::record(const char* name, rak::timer duration) {
+  int64_t usec = duration.usec();
+
+  // Guard against the clock being adjusted backwards.
+  find_histogram(this, name)->insert(usec < 0 ? 0 : usec);
+}
+
+void
+Profiler::perform_tasks(rak::priority_queue_default* queue, rak::timer t) {
+  if (!m_enabled)
+    return rak::priority_queue_perform(queue, t);
+
+  while (!queue->empty() && queue->top()->time() <= t) {
+    rak::priority_item* v = queue->top();
+    queue->pop();
+
+    v->clear_time();
+
+    // Look up the histogram first as the task may delete itself.
+    ProfileHistogram* histogram = find_histogram(&m_tasks, v->name() != NULL ? v->name() : "unnamed");
+    rak::timer start = rak::timer::current();
+
+    v->call();
+
+    int64_t usec = (rak::timer::current() - start).usec();
+    histogram->insert(usec < 0 ? 0 : usec);
+  }
+}
+
+static void
+profiler_list_rows(torrent::Object::list_type& result, const Profiler::base_type& histograms, const char* prefix) {
+  for (Profiler::const_iterator itr = histograms.begin(), last = histograms.end(); itr != last; itr++) {
+    if (itr->second.count() == 0)
+      continue;
+
+    torrent::Object::list_type& row = result.insert(result.end(), torrent::Object::create_list())->as_list();
+
+    row.push_back(std::string(prefix) + itr->first);
+    row.push_back((int64_t)itr->second.count());
+    row.push_back((int64_t)itr->second.total());
+    row.push_back((int64_t)itr->second.max());
+    row.push_back((int64_t)itr->second.percentile(50));
+    row.push_back((int64_t)itr->second.percentile(90));
+    row.push_back((int64_t)itr->second.percentile(99));
+  }
+}
+
+static void
+profiler_dump_rows(std::ostream& file, const Profiler::base_type& histograms, const char* prefix) {
+  for (Profiler::const_iterator itr = histograms.begin(), last = histograms.end(); itr != last; itr++) {
+    if (itr->second.count() == 0)
+      continue;
+
+    file << prefix << itr->first << ' '
+         << itr->second.count() << ' '
+         << itr->second.total() << ' '
+         << itr->second.max() << ' '
+         << itr->second.percentile(50) << ' '
+         << itr->second.percentile(90) << ' '
+         << itr->second.percentile(99) << std::endl;
+  }
+}
+
+torrent::Object
+Profiler::list() const {
+  torrent::Object resultRaw = torrent::Object::create_list();
+
+  profiler_list_rows(resultRaw.as_list(), *this, "");
+  profiler_list_rows(resultRaw.as_list(), m_tasks, "task.");
+
+  return resultRaw;
+}
+
+void
+Profiler::dump(const std::string& filename) const {
+  std::fstream file(filename.c_str(), std::ios::out | std::ios::trunc);
+
+  if (!file.is_open())
+    throw torrent::input_error("Could not open profile dump file: " + filename);
+
+  file << "# name count total_usec max_usec p50_usec p90_usec p99_usec" << std::endl;
+
+  profiler_dump_rows(file, *this, "");
+  profiler_dump_rows(file, m_tasks, "task.");
+}
+
+}
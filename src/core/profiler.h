@@ -0,0 +1,149 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_CORE_PROFILER_H
+#define RTORRENT_CORE_PROFILER_H
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <inttypes.h>
+#include <rak/priority_queue_default.h>
+#include <rak/timer.h>
+
+namespace torrent {
+  class Object;
+}
+
+namespace core {
+
+// Collects wall-clock timings of the main loop, grouped by source
+// name. Each source keeps a histogram with power-of-two microsecond
+// buckets so that percentiles can be estimated without storing the
+// samples. Recording is skipped entirely while disabled.
+
+class ProfileHistogram {
+public:
+  static const unsigned int size_buckets = 32;
+
+  ProfileHistogram() : m_count(0), m_total(0), m_max(0) { std::fill(m_buckets, m_buckets + size_buckets, 0); }
+
+  uint64_t            count() const                   { return m_count; }
+  uint64_t            total() const                   { return m_total; }
+  uint64_t            max() const                     { return m_max; }
+
+  void                insert(uint64_t usec);
+
+  // Returns the upper bound of the bucket holding the given
+  // percentile, clamped to the largest sample seen.
+  uint64_t            percentile(unsigned int percent) const;
+
+private:
+  uint64_t            m_count;
+  uint64_t            m_total;
+  uint64_t            m_max;
+  uint64_t            m_buckets[size_buckets];
+};
+
+struct profile_name_comp : public std::binary_function<const char*, const char*, bool> {
+  bool operator () (const char* arg1, const char* arg2) const { return std::strcmp(arg1, arg2) < 0; }
+};
+
+// The keys are copies owned by the profiler, so samples can be
+// looked up by any C string without allocating. Entries are never
+// erased, only cleared, keeping the histogram pointers stable while a
+// task runs.
+
+class Profiler : public std::map<const char*, ProfileHistogram, profile_name_comp> {
+public:
+  typedef std::map<const char*, ProfileHistogram, profile_name_comp> base_type;
+
+  Profiler() : m_enabled(false) {}
+  ~Profiler();
+
+  bool                is_enabled() const              { return m_enabled; }
+  void                set_enabled(bool v)             { m_enabled = v; }
+
+  void                reset();
+
+  void                record(const char* name, rak::timer duration);
+
+  // Replaces rak::priority_queue_perform, timing each task by its
+  // name when enabled. Tasks are listed with a "task." prefix.
+  void                perform_tasks(rak::priority_queue_default* queue, rak::timer t);
+
+  // List of [name, count, total, max, p50, p90, p99] with times in
+  // microseconds.
+  torrent::Object     list() const;
+
+  void                dump(const std::string& filename) const;
+
+private:
+  Profiler(const Profiler&);
+  void operator = (const Profiler&);
+
+  static ProfileHistogram* find_histogram(base_type* histograms, const char* name);
+
+  bool                m_enabled;
+  base_type           m_tasks;
+};
+
+class ProfileScope {
+public:
+  ProfileScope(Profiler* profiler, const char* name) :
+    m_profiler(profiler->is_enabled() ? profiler : NULL),
+    m_name(name),
+    m_start(m_profiler != NULL ? rak::timer::current() : rak::timer()) {}
+
+  ~ProfileScope() {
+    if (m_profiler != NULL)
+      m_profiler->record(m_name, rak::timer::current() - m_start);
+  }
+
+private:
+  ProfileScope(const ProfileScope&);
+  void operator = (const ProfileScope&);
+
+  Profiler*           m_profiler;
+  const char*         m_name;
+  rak::timer          m_start;
+};
+
+}
+
+#endif
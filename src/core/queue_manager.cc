@@ -0,0 +1,419 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include <sys/stat.h>
+#include <torrent/exceptions.h>
+#include <torrent/object.h>
+#include <torrent/tracker.h>
+#include <torrent/tracker_list.h>
+#include <torrent/data/file_list.h>
+
+#include "globals.h"
+#include "control.h"
+#include "download.h"
+#include "download_list.h"
+#include "manager.h"
+#include "queue_manager.h"
+
+namespace core {
+
+// Disks are told apart by the device of the download's directory, or
+// of its parent if the directory hasn't been created yet.
+static uint64_t
+queue_manager_disk(Download* download) {
+  std::string path = download->file_list()->root_dir();
+  struct stat sb;
+
+  if (!path.empty() && ::stat(path.c_str(), &sb) == 0)
+    return sb.st_dev;
+
+  if (path.size() > 1 && path[path.size() - 1] == '/')
+    path.resize(path.size() - 1);
+
+  std::string::size_type pos = path.rfind('/');
+
+  if (pos != std::string::npos && ::stat(path.substr(0, std::max<std::string::size_type>(pos, 1)).c_str(), &sb) == 0)
+    return sb.st_dev;
+
+  return 0;
+}
+
+// The host of the first tracker, empty for downloads without any.
+static std::string
+queue_manager_tracker(Download* download) {
+  if (download->tracker_list()->size() == 0)
+    return std::string();
+
+  const std::string& url = download->tracker_list()->at(0)->url();
+
+  std::string::size_type first = url.find("://");
+  first = first != std::string::npos ? first + 3 : 0;
+
+  std::string::size_type last = url.find_first_of(":/", first);
+
+  return url.substr(first, last != std::string::npos ? last - first : std::string::npos);
+}
+
+template <typename Map>
+static unsigned int
+queue_manager_count(const Map& map, const typename Map::key_type& key) {
+  typename Map::const_iterator itr = map.find(key);
+
+  return itr != map.end() ? itr->second : 0;
+}
+
+template <typename Map>
+static void
+queue_manager_add(Map& map, const typename Map::key_type& key, int delta) {
+  typename Map::iterator itr = map.insert(typename Map::value_type(key, 0)).first;
+
+  if ((itr->second += delta) == 0)
+    map.erase(itr);
+}
+
+static inline bool
+queue_manager_above(unsigned int count, int64_t limit) {
+  return limit >= 0 && count > (uint64_t)limit;
+}
+
+QueueManager::QueueManager() :
+  m_sequence(0),
+  m_updating(false),
+  m_downloading(0),
+  m_seeding(0),
+  m_maxDownloading(-1),
+  m_maxSeeding(-1),
+  m_maxPerDisk(-1),
+  m_maxPerTracker(-1),
+  m_aging(0) {
+}
+
+bool
+QueueManager::is_active(Download* d) const {
+  entry_map::const_iterator itr = m_entries.find(d);
+
+  return itr != m_entries.end() && itr->second.m_active;
+}
+
+void
+QueueManager::insert(Download* d) {
+  if (is_queued(d))
+    return;
+
+  entry_type entry;
+  entry.m_sequence = m_sequence++;
+  entry.m_queued = cachedTime;
+  entry.m_active = d->is_active();
+  entry.m_seeding = d->is_done();
+  entry.m_held = false;
+  entry.m_waiting = false;
+  entry.m_disk = queue_manager_disk(d);
+  entry.m_tracker = queue_manager_tracker(d);
+
+  entry_map::iterator itr = m_entries.insert(entry_map::value_type(d, entry)).first;
+
+  // Downloads that were started behind our back keep their slot.
+  if (entry.m_active)
+    count(entry, 1);
+  else
+    wait(itr);
+
+  fill();
+}
+
+void
+QueueManager::erase(Download* d) {
+  entry_map::iterator itr = m_entries.find(d);
+
+  if (itr == m_entries.end())
+    return;
+
+  unwait(itr);
+
+  if (itr->second.m_active)
+    count(itr->second, -1);
+
+  m_entries.erase(itr);
+  control->core()->download_list()->pause(d);
+
+  fill();
+}
+
+void
+QueueManager::finished(Download* d) {
+  entry_map::iterator itr = m_entries.find(d);
+
+  if (itr == m_entries.end() || itr->second.m_seeding)
+    return;
+
+  unwait(itr);
+
+  if (itr->second.m_active) {
+    count(itr->second, -1);
+    itr->second.m_seeding = true;
+    count(itr->second, 1);
+
+    // Only this entry changed, so rather than ranking every active
+    // download it alone gives way if seeding is now over a limit.
+    if (is_exceeding(itr->second))
+      deactivate(itr);
+
+  } else {
+    itr->second.m_seeding = true;
+    wait(itr);
+  }
+
+  fill();
+}
+
+void
+QueueManager::paused(Download* d) {
+  entry_map::iterator itr = m_entries.find(d);
+
+  // Pausing by the manager itself clears 'm_active' first.
+  if (itr == m_entries.end() || !itr->second.m_active)
+    return;
+
+  itr->second.m_active = false;
+  itr->second.m_held = true;
+  count(itr->second, -1);
+
+  fill();
+}
+
+void
+QueueManager::resumed(Download* d) {
+  entry_map::iterator itr = m_entries.find(d);
+
+  if (itr == m_entries.end() || itr->second.m_active)
+    return;
+
+  unwait(itr);
+
+  itr->second.m_active = true;
+  itr->second.m_held = false;
+  count(itr->second, 1);
+}
+
+void
+QueueManager::update() {
+  if (m_updating)
+    return;
+
+  // Priorities and aging may have changed, so order the waiting
+  // downloads anew.
+  m_waiting[0].clear();
+  m_waiting[1].clear();
+
+  for (entry_map::iterator itr = m_entries.begin(), last = m_entries.end(); itr != last; itr++) {
+    itr->second.m_waiting = false;
+    wait(itr);
+  }
+
+  // Rank the active downloads worst first, that is lowest priority
+  // and then most recently queued, and pause those that are over any
+  // of their limits.
+  typedef std::pair<order_type, Download*> ranked_type;
+  std::vector<ranked_type> ranked;
+
+  for (entry_map::const_iterator itr = m_entries.begin(), last = m_entries.end(); itr != last; itr++)
+    if (itr->second.m_active)
+      ranked.push_back(ranked_type(order(itr->first, itr->second), itr->first));
+
+  std::sort(ranked.begin(), ranked.end(), std::greater<ranked_type>());
+
+  for (std::vector<ranked_type>::const_iterator itr = ranked.begin(), last = ranked.end(); itr != last; itr++) {
+    entry_map::iterator entryItr = m_entries.find(itr->second);
+
+    if (entryItr != m_entries.end() && entryItr->second.m_active && is_exceeding(entryItr->second))
+      deactivate(entryItr);
+  }
+
+  fill();
+}
+
+torrent::Object
+QueueManager::status() const {
+  torrent::Object result = torrent::Object::create_map();
+
+  result.insert_key("queued",      (int64_t)m_entries.size());
+  result.insert_key("downloading", (int64_t)m_downloading);
+  result.insert_key("seeding",     (int64_t)m_seeding);
+  result.insert_key("waiting",     (int64_t)(m_entries.size() - m_downloading - m_seeding));
+
+  torrent::Object& disks = result.insert_key("disks", torrent::Object::create_map());
+
+  for (disk_map::const_iterator itr = m_disks.begin(), last = m_disks.end(); itr != last; itr++) {
+    char buffer[32];
+    snprintf(buffer, 32, "%llu", (unsigned long long)itr->first);
+
+    disks.insert_key(buffer, (int64_t)itr->second);
+  }
+
+  torrent::Object& trackers = result.insert_key("trackers", torrent::Object::create_map());
+
+  for (tracker_map::const_iterator itr = m_trackers.begin(), last = m_trackers.end(); itr != last; itr++)
+    trackers.insert_key(itr->first, (int64_t)itr->second);
+
+  return result;
+}
+
+QueueManager::order_type
+QueueManager::order(Download* d, const entry_type& entry) const {
+  if (m_aging > 0)
+    return order_type(entry.m_queued.seconds() - d->priority() * m_aging, entry.m_sequence);
+  else
+    return order_type(-(int64_t)d->priority(), entry.m_sequence);
+}
+
+void
+QueueManager::wait(entry_map::iterator itr) {
+  if (itr->second.m_waiting || itr->second.m_active || itr->second.m_held || itr->first->priority() == 0)
+    return;
+
+  itr->second.m_waiting = true;
+  itr->second.m_order = order(itr->first, itr->second);
+
+  m_waiting[itr->second.m_seeding].insert(waiting_map::value_type(itr->second.m_order, itr));
+}
+
+void
+QueueManager::unwait(entry_map::iterator itr) {
+  if (!itr->second.m_waiting)
+    return;
+
+  itr->second.m_waiting = false;
+  m_waiting[itr->second.m_seeding].erase(itr->second.m_order);
+}
+
+bool
+QueueManager::can_activate(const entry_type& entry) const {
+  if (entry.m_seeding ? is_over(m_seeding, m_maxSeeding) : is_over(m_downloading, m_maxDownloading))
+    return false;
+
+  if (!entry.m_seeding && is_over(queue_manager_count(m_disks, entry.m_disk), m_maxPerDisk))
+    return false;
+
+  return entry.m_tracker.empty() || !is_over(queue_manager_count(m_trackers, entry.m_tracker), m_maxPerTracker);
+}
+
+bool
+QueueManager::is_exceeding(const entry_type& entry) const {
+  if (entry.m_seeding ? queue_manager_above(m_seeding, m_maxSeeding) : queue_manager_above(m_downloading, m_maxDownloading))
+    return true;
+
+  if (!entry.m_seeding && queue_manager_above(queue_manager_count(m_disks, entry.m_disk), m_maxPerDisk))
+    return true;
+
+  return !entry.m_tracker.empty() && queue_manager_above(queue_manager_count(m_trackers, entry.m_tracker), m_maxPerTracker);
+}
+
+void
+QueueManager::count(const entry_type& entry, int delta) {
+  if (entry.m_seeding) {
+    m_seeding += delta;
+
+  } else {
+    m_downloading += delta;
+    queue_manager_add(m_disks, entry.m_disk, delta);
+  }
+
+  if (!entry.m_tracker.empty())
+    queue_manager_add(m_trackers, entry.m_tracker, delta);
+}
+
+void
+QueueManager::activate(entry_map::iterator itr) {
+  unwait(itr);
+
+  itr->second.m_active = true;
+  count(itr->second, 1);
+
+  control->core()->download_list()->resume(itr->first);
+}
+
+void
+QueueManager::deactivate(entry_map::iterator itr) {
+  itr->second.m_active = false;
+  count(itr->second, -1);
+
+  control->core()->download_list()->pause(itr->first);
+
+  wait(itr);
+}
+
+// Starts waiting downloads in order while they fit within the limits,
+// without walking a list whose global limit is already reached. The
+// walk restarts after each start as event handlers called by resume()
+// may change the lists, and is guarded so that they can't recurse
+// into it.
+void
+QueueManager::fill() {
+  if (m_updating)
+    return;
+
+  m_updating = true;
+
+  try {
+    for (int seeding = 0; seeding != 2; seeding++) {
+      waiting_map::iterator itr = m_waiting[seeding].begin();
+
+      while (itr != m_waiting[seeding].end() && !(seeding ? is_over(m_seeding, m_maxSeeding) : is_over(m_downloading, m_maxDownloading))) {
+        entry_map::iterator entryItr = (itr++)->second;
+
+        if (entryItr->first->is_hash_failed() || !can_activate(entryItr->second))
+          continue;
+
+        activate(entryItr);
+        itr = m_waiting[seeding].begin();
+      }
+    }
+
+  } catch (...) {
+    m_updating = false;
+    throw;
+  }
+
+  m_updating = false;
+}
+
+}
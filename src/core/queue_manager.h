@@ -0,0 +1,184 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_CORE_QUEUE_MANAGER_H
+#define RTORRENT_CORE_QUEUE_MANAGER_H
+
+#include <map>
+#include <string>
+#include <inttypes.h>
+#include <rak/timer.h>
+
+namespace torrent {
+  class Object;
+}
+
+namespace core {
+
+class Download;
+
+// Decides which of the started downloads get to be active. Downloads
+// are inserted when they enter the 'started' view and erased when
+// they leave it, and the manager keeps its own counts so that slots
+// are handed out as they free up instead of rescanning the views.
+//
+// Waiting downloads are kept ordered by 'd.get_priority', then by the
+// time they were queued. With aging enabled every 'aging' seconds
+// spent waiting counts as one step of priority, so low priority
+// downloads aren't starved; the order is then by queue time less
+// 'aging' seconds per step of priority, which doesn't change as time
+// passes. Downloads with priority off are never started.
+//
+// Downloads paused by hand or by another controller are held, and
+// not started again until they are resumed. Resuming by hand takes
+// the download's slot even when over the limits.
+//
+// Downloading and seeding have separate limits, downloads are also
+// limited per disk and both are limited per tracker host. Negative
+// limits are unlimited.
+
+class QueueManager {
+public:
+  typedef std::map<uint64_t, unsigned int>    disk_map;
+  typedef std::map<std::string, unsigned int> tracker_map;
+
+  QueueManager();
+
+  int64_t             max_downloading() const               { return m_maxDownloading; }
+  void                set_max_downloading(int64_t v)        { m_maxDownloading = v; update(); }
+
+  int64_t             max_seeding() const                   { return m_maxSeeding; }
+  void                set_max_seeding(int64_t v)            { m_maxSeeding = v; update(); }
+
+  int64_t             max_per_disk() const                  { return m_maxPerDisk; }
+  void                set_max_per_disk(int64_t v)           { m_maxPerDisk = v; update(); }
+
+  int64_t             max_per_tracker() const               { return m_maxPerTracker; }
+  void                set_max_per_tracker(int64_t v)        { m_maxPerTracker = v; update(); }
+
+  // Seconds of waiting per step of priority, zero disables aging.
+  int64_t             aging() const                         { return m_aging; }
+  void                set_aging(int64_t v)                  { m_aging = v; update(); }
+
+  bool                is_queued(Download* d) const          { return m_entries.find(d) != m_entries.end(); }
+  bool                is_active(Download* d) const;
+
+  size_t              size() const                          { return m_entries.size(); }
+  unsigned int        size_downloading() const              { return m_downloading; }
+  unsigned int        size_seeding() const                  { return m_seeding; }
+
+  void                insert(Download* d);
+  void                erase(Download* d);
+
+  // Moves a download that just finished from the downloading to the
+  // seeding counts and fills the freed slot, without rebuilding the
+  // waiting order.
+  void                finished(Download* d);
+
+  // Called on 'event.download.paused' and 'event.download.resumed' so
+  // the counts follow downloads paused or resumed by others.
+  void                paused(Download* d);
+  void                resumed(Download* d);
+
+  // Pauses the lowest ranked active downloads while over a limit and
+  // starts waiting ones while under. Limits and priorities may have
+  // changed since the last call, so the waiting order is rebuilt.
+  void                update();
+
+  torrent::Object     status() const;
+
+private:
+  // Lower is started first, the sequence makes it unique.
+  typedef std::pair<int64_t, uint64_t> order_type;
+
+  struct entry_type {
+    uint64_t          m_sequence;
+    rak::timer        m_queued;
+
+    bool              m_active;
+    bool              m_seeding;
+    bool              m_held;
+
+    bool              m_waiting;
+    order_type        m_order;
+
+    uint64_t          m_disk;
+    std::string       m_tracker;
+  };
+
+  typedef std::map<Download*, entry_type>             entry_map;
+  typedef std::map<order_type, entry_map::iterator>   waiting_map;
+
+  static bool         is_over(unsigned int count, int64_t limit) { return limit >= 0 && count >= (uint64_t)limit; }
+
+  order_type          order(Download* d, const entry_type& entry) const;
+
+  void                wait(entry_map::iterator itr);
+  void                unwait(entry_map::iterator itr);
+
+  bool                can_activate(const entry_type& entry) const;
+  bool                is_exceeding(const entry_type& entry) const;
+
+  void                count(const entry_type& entry, int delta);
+
+  void                activate(entry_map::iterator itr);
+  void                deactivate(entry_map::iterator itr);
+
+  void                fill();
+
+  entry_map           m_entries;
+
+  // Entries neither active, held nor with priority off, split by
+  // downloading and seeding.
+  waiting_map         m_waiting[2];
+  uint64_t            m_sequence;
+  bool                m_updating;
+
+  unsigned int        m_downloading;
+  unsigned int        m_seeding;
+  disk_map            m_disks;
+  tracker_map         m_trackers;
+
+  int64_t             m_maxDownloading;
+  int64_t             m_maxSeeding;
+  int64_t             m_maxPerDisk;
+  int64_t             m_maxPerTracker;
+  int64_t             m_aging;
+};
+
+}
+
+#endif
@@ -0,0 +1,285 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <functional>
+#include <sys/resource.h>
+#include <torrent/connection_manager.h>
+#include <torrent/exceptions.h>
+#include <torrent/object.h>
+#include <torrent/rate.h>
+#include <torrent/torrent.h>
+#include <torrent/peer/connection_list.h>
+
+#include "rpc/parse_commands.h"
+
+#include "globals.h"
+#include "control.h"
+#include "download.h"
+#include "download_list.h"
+#include "manager.h"
+#include "slot_allocator.h"
+
+namespace core {
+
+// Upload rate that counts as much as one connected leecher.
+static const uint32_t slot_allocator_rate_unit = 16 << 10;
+
+// Incomplete downloads need peers to finish at all.
+static const uint64_t slot_allocator_incomplete_weight = 16;
+
+SlotAllocator::SlotAllocator() :
+  m_interval(0),
+  m_minPeers(5),
+  m_uploads(0),
+  m_reserve(128),
+  m_downloads(0),
+  m_allocatedPeers(0),
+  m_allocatedUploads(0) {
+
+  m_task.set_slot(rak::mem_fn(this, &SlotAllocator::receive_rebalance));
+  m_task.set_name("network.budget");
+}
+
+SlotAllocator::~SlotAllocator() {
+  priority_queue_erase(&taskScheduler, &m_task);
+}
+
+void
+SlotAllocator::set_interval(int64_t v) {
+  if (v < 0)
+    throw torrent::input_error("Invalid interval.");
+
+  if (v == 0 && m_interval != 0)
+    restore();
+
+  m_interval = v;
+
+  priority_queue_erase(&taskScheduler, &m_task);
+
+  if (m_interval != 0)
+    priority_queue_insert(&taskScheduler, &m_task, (cachedTime + rak::timer::from_seconds(m_interval)).round_seconds());
+}
+
+void
+SlotAllocator::set_min_peers(int64_t v) {
+  if (v < 0 || v > (1 << 16))
+    throw torrent::input_error("Invalid number of peers.");
+
+  m_minPeers = v;
+}
+
+void
+SlotAllocator::set_uploads(int64_t v) {
+  if (v < 0 || v > (1 << 16))
+    throw torrent::input_error("Invalid number of uploads.");
+
+  m_uploads = v;
+}
+
+void
+SlotAllocator::set_reserve(int64_t v) {
+  if (v < 0 || v > (1 << 16))
+    throw torrent::input_error("Invalid number of file descriptors.");
+
+  m_reserve = v;
+}
+
+uint32_t
+SlotAllocator::socket_budget() const {
+  uint64_t budget = torrent::connection_manager()->max_size();
+  struct rlimit rlim;
+
+  if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur != RLIM_INFINITY) {
+    uint64_t used = torrent::max_open_files() + m_reserve;
+
+    budget = std::min<uint64_t>(budget, rlim.rlim_cur > used ? rlim.rlim_cur - used : 0);
+  }
+
+  return budget;
+}
+
+uint32_t
+SlotAllocator::upload_budget() const {
+  return m_uploads != 0 ? m_uploads : torrent::max_unchoked();
+}
+
+void
+SlotAllocator::rebalance() {
+  int64_t maxPeers     = rpc::call_command_value("get_max_peers");
+  int64_t maxPeersSeed = rpc::call_command_value("get_max_peers_seed");
+  int64_t minPeers     = rpc::call_command_value("get_min_peers");
+  int64_t minPeersSeed = rpc::call_command_value("get_min_peers_seed");
+  int64_t maxUploads   = rpc::call_command_value("get_max_uploads");
+
+  demand_list demands;
+  download_set touched;
+  uint64_t peerWeights = 0;
+  uint64_t uploadWeights = 0;
+
+  for (DownloadList::iterator itr = control->core()->download_list()->begin(), last = control->core()->download_list()->end(); itr != last; itr++) {
+    // Drop erased downloads from the set of changed downloads.
+    if (m_touched.find(*itr) != m_touched.end())
+      touched.insert(*itr);
+
+    if (!(*itr)->is_active())
+      continue;
+
+    uint32_t connected = (*itr)->connection_list()->size();
+    uint32_t complete = (*itr)->download()->peers_complete();
+    uint32_t leechers = connected > complete ? connected - complete : 0;
+    uint32_t rate = (*itr)->download()->up_rate()->rate() / slot_allocator_rate_unit;
+
+    demand_type demand;
+    demand.m_download = *itr;
+    demand.m_uploadWeight = leechers + rate;
+    demand.m_peerWeight = 1 + leechers + rate + ((*itr)->is_done() ? 0 : slot_allocator_incomplete_weight);
+    demand.m_maxPeers = (*itr)->is_done() && maxPeersSeed >= 0 ? maxPeersSeed : maxPeers;
+
+    peerWeights += demand.m_peerWeight;
+    uploadWeights += demand.m_uploadWeight;
+
+    demands.push_back(demand);
+  }
+
+  m_touched.swap(touched);
+
+  m_downloads = demands.size();
+  m_allocatedPeers = 0;
+  m_allocatedUploads = 0;
+
+  if (demands.empty())
+    return;
+
+  uint64_t peerBudget = socket_budget();
+  uint64_t peerFloor = std::min<uint64_t>(m_minPeers, peerBudget / demands.size());
+  uint64_t peerRest = peerBudget - peerFloor * demands.size();
+
+  uint64_t uploadBudget = upload_budget();
+  uint64_t uploadFloor = uploadBudget >= demands.size() ? 1 : 0;
+  uint64_t uploadRest = uploadBudget - uploadFloor * demands.size();
+
+  // Too few upload slots for one each, so only the downloads with the
+  // most demand get one.
+  if (uploadFloor == 0)
+    std::stable_sort(demands.begin(), demands.end(), std::greater<demand_type>());
+
+  for (demand_list::const_iterator itr = demands.begin(), last = demands.end(); itr != last; itr++) {
+    uint64_t peers = std::min<uint64_t>(peerFloor + peerRest * itr->m_peerWeight / peerWeights, itr->m_maxPeers);
+    uint64_t peersMin = itr->m_download->is_done() && minPeersSeed >= 0 ? minPeersSeed : minPeers;
+
+    itr->m_download->connection_list()->set_max_size(peers);
+    itr->m_download->connection_list()->set_min_size(std::min(peersMin, peers));
+
+    m_allocatedPeers += peers;
+    m_touched.insert(itr->m_download);
+
+    // A zero upload budget means the unchoke limit is unlimited, so
+    // leave the per-download setting alone.
+    if (uploadBudget == 0)
+      continue;
+
+    uint64_t uploads;
+
+    if (uploadFloor == 0)
+      uploads = (uint64_t)(itr - demands.begin()) < uploadBudget ? 1 : 0;
+    else if (uploadWeights != 0)
+      uploads = uploadFloor + uploadRest * itr->m_uploadWeight / uploadWeights;
+    else
+      uploads = uploadFloor;
+
+    if (maxUploads > 0)
+      uploads = std::min<uint64_t>(uploads, maxUploads);
+
+    itr->m_download->download()->set_uploads_max(uploads);
+    m_allocatedUploads += uploads;
+  }
+}
+
+// Put the downloads the allocator has changed back on the configured
+// limits, the same way DownloadFactory sets them up.
+void
+SlotAllocator::restore() {
+  for (DownloadList::iterator itr = control->core()->download_list()->begin(), last = control->core()->download_list()->end(); itr != last; itr++) {
+    if (m_touched.find(*itr) == m_touched.end())
+      continue;
+
+    rpc::call_command("d.set_uploads_max", rpc::call_command_void("get_max_uploads"), rpc::make_target(*itr));
+    rpc::call_command("d.set_peers_min",   rpc::call_command_void("get_min_peers"), rpc::make_target(*itr));
+    rpc::call_command("d.set_peers_max",   rpc::call_command_void("get_max_peers"), rpc::make_target(*itr));
+
+    if ((*itr)->is_done()) {
+      if (rpc::call_command_value("get_min_peers_seed") >= 0)
+        rpc::call_command("d.set_peers_min", rpc::call_command_void("get_min_peers_seed"), rpc::make_target(*itr));
+
+      if (rpc::call_command_value("get_max_peers_seed") >= 0)
+        rpc::call_command("d.set_peers_max", rpc::call_command_void("get_max_peers_seed"), rpc::make_target(*itr));
+    }
+  }
+
+  m_touched.clear();
+  m_downloads = 0;
+  m_allocatedPeers = 0;
+  m_allocatedUploads = 0;
+}
+
+torrent::Object
+SlotAllocator::status() const {
+  torrent::Object result = torrent::Object::create_map();
+
+  result.insert_key("enabled",           (int64_t)is_enabled());
+  result.insert_key("downloads",         (int64_t)m_downloads);
+  result.insert_key("socket_budget",     (int64_t)socket_budget());
+  result.insert_key("upload_budget",     (int64_t)upload_budget());
+  result.insert_key("allocated_peers",   (int64_t)m_allocatedPeers);
+  result.insert_key("allocated_uploads", (int64_t)m_allocatedUploads);
+
+  return result;
+}
+
+void
+SlotAllocator::receive_rebalance() {
+  if (control->is_shutdown_started())
+    return;
+
+  rebalance();
+
+  priority_queue_insert(&taskScheduler, &m_task, (cachedTime + rak::timer::from_seconds(m_interval)).round_seconds());
+}
+
+}
@@ -0,0 +1,137 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_CORE_SLOT_ALLOCATOR_H
+#define RTORRENT_CORE_SLOT_ALLOCATOR_H
+
+#include <set>
+#include <vector>
+#include <inttypes.h>
+#include <rak/priority_queue_default.h>
+
+namespace torrent {
+  class Object;
+}
+
+namespace core {
+
+class Download;
+
+// Splits a global peer socket budget and upload slot budget across
+// the active downloads by demand, instead of giving each download the
+// same 'max_peers' and 'max_uploads'.
+//
+// The socket budget is 'max_open_sockets', further limited by
+// RLIMIT_NOFILE minus 'max_open_files' and a reserve for everything
+// else. The upload budget is 'network.budget.uploads', or the global
+// unchoke limit if that is zero.
+//
+// Every download gets 'min_peers' sockets and, if the budget allows,
+// one upload slot, the rest is shared by weight. With fewer upload
+// slots than downloads only the downloads with the most demand get
+// one. Incomplete downloads weigh more since they need peers to
+// finish, and otherwise the weight follows the number of connected
+// leechers and the recent upload rate. Downloads never get more than
+// the configured 'max_peers', 'max_peers_seed' and 'max_uploads'.
+// Disabling the allocator puts the downloads it changed back on
+// those limits.
+
+class SlotAllocator {
+public:
+  SlotAllocator();
+  ~SlotAllocator();
+
+  bool                is_enabled() const                  { return m_task.is_queued(); }
+
+  // Seconds between each rebalance, zero disables the allocator and
+  // restores the configured per-download limits.
+  int64_t             interval() const                    { return m_interval; }
+  void                set_interval(int64_t v);
+
+  int64_t             min_peers() const                   { return m_minPeers; }
+  void                set_min_peers(int64_t v);
+
+  int64_t             uploads() const                     { return m_uploads; }
+  void                set_uploads(int64_t v);
+
+  // File descriptors kept out of the socket budget for trackers,
+  // RPC, logs and the like.
+  int64_t             reserve() const                     { return m_reserve; }
+  void                set_reserve(int64_t v);
+
+  uint32_t            socket_budget() const;
+  uint32_t            upload_budget() const;
+
+  void                rebalance();
+
+  torrent::Object     status() const;
+
+private:
+  SlotAllocator(const SlotAllocator&);
+  void operator = (const SlotAllocator&);
+
+  struct demand_type {
+    Download*         m_download;
+    uint64_t          m_peerWeight;
+    uint64_t          m_uploadWeight;
+    uint32_t          m_maxPeers;
+
+    bool operator > (const demand_type& d) const { return m_uploadWeight > d.m_uploadWeight; }
+  };
+
+  typedef std::vector<demand_type> demand_list;
+  typedef std::set<Download*>      download_set;
+
+  void                receive_rebalance();
+  void                restore();
+
+  rak::priority_item  m_task;
+
+  int64_t             m_interval;
+  int64_t             m_minPeers;
+  int64_t             m_uploads;
+  int64_t             m_reserve;
+
+  uint32_t            m_downloads;
+  uint64_t            m_allocatedPeers;
+  uint64_t            m_allocatedUploads;
+
+  download_set        m_touched;
+};
+
+}
+
+#endif
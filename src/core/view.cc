@@ -40,10 +40,12 @@
 #include <functional>
 #include <rak/functional.h>
 #include <rak/functional_fun.h>
+#include <rak/string_manip.h>
 #include <rpc/parse_commands.h>
 #include <sigc++/adaptors/bind.h>
 #include <torrent/download.h>
 #include <torrent/exceptions.h>
+#include <torrent/hash_string.h>
 
 #include "control.h"
 #include "download.h"
@@ -55,13 +57,16 @@ namespace core {
 
 // Also add focus thingie here?
 struct view_downloads_compare : std::binary_function<Download*, Download*, bool> {
-  view_downloads_compare(const std::string& cmd) : m_command(cmd) {}
+  view_downloads_compare(const std::string& cmd, rpc::Expression* expr) : m_command(cmd), m_expression(expr) {}
 
   bool operator () (Download* d1, Download* d2) const {
     try {
       if (m_command.empty())
         return false;
 
+      if (!m_expression->empty())
+        return m_expression->evaluate_bool(rpc::make_target_pair(d1, d2));
+
       return rpc::parse_command_single(rpc::make_target_pair(d1, d2), m_command).as_value();
 
     } catch (torrent::input_error& e) {
@@ -72,16 +77,20 @@ struct view_downloads_compare : std::binary_function<Download*, Download*, bool>
   }
 
   const std::string& m_command;
+  rpc::Expression*   m_expression;
 };
 
 struct view_downloads_filter : std::unary_function<Download*, bool> {
-  view_downloads_filter(const std::string& cmd) : m_command(cmd) {}
+  view_downloads_filter(const std::string& cmd, rpc::Expression* expr) : m_command(cmd), m_expression(expr) {}
 
   bool operator () (Download* d1) const {
     if (m_command.empty())
       return true;
 
     try {
+      if (!m_expression->empty())
+        return m_expression->evaluate_bool(rpc::make_target(d1));
+
       torrent::Object result = rpc::parse_command_single(rpc::make_target(d1), m_command);
 
       switch (result.type()) {
@@ -104,6 +113,7 @@ struct view_downloads_filter : std::unary_function<Download*, bool> {
   }
 
   const std::string&       m_command;
+  rpc::Expression*         m_expression;
 };
 
 inline void
@@ -112,6 +122,31 @@ View::emit_changed() {
   priority_queue_insert(&taskScheduler, &m_delayChanged, cachedTime);
 }
 
+// Downloads entering the view get a new generation so that
+// d.multicall.since sends all their columns, while those leaving are
+// logged so it can report them.
+void
+View::received_added(Download* d) {
+  d->set_generation(control->core()->download_list()->next_generation());
+
+  if (!m_eventAdded.empty())
+    rpc::call_compiled_d_nothrow(d, &m_eventAdded);
+}
+
+void
+View::received_removed(Download* d) {
+  const torrent::HashString& hash = d->download()->info_hash();
+  m_removed.push_back(std::make_pair(control->core()->download_list()->next_generation(), rak::transform_hex(hash.begin(), hash.end())));
+
+  if (m_removed.size() > max_removed_size) {
+    m_removedTrimmed = m_removed.front().first;
+    m_removed.pop_front();
+  }
+
+  if (!m_eventRemoved.empty())
+    rpc::call_compiled_d_nothrow(d, &m_eventRemoved);
+}
+
 View::~View() {
   if (m_name.empty())
     return;
@@ -140,6 +175,7 @@ View::initialize(const std::string& name) {
 
   set_last_changed(rak::timer());
   m_delayChanged.set_slot(rak::mem_fn(&m_signalChanged, &signal_type::operator()));
+  m_delayChanged.set_name("view.changed");
 }
 
 void
@@ -151,7 +187,7 @@ View::erase(Download* download) {
 
   } else {
     erase_internal(itr);
-    rpc::parse_command_multiple_d_nothrow(download, m_eventRemoved);
+    received_removed(download);
   }
 }
 
@@ -167,7 +203,7 @@ View::set_visible(Download* download) {
   base_type::erase(itr);
   insert_visible(download);
 
-  rpc::parse_command_multiple_d_nothrow(download, m_eventAdded);
+  received_added(download);
 }
 
 void
@@ -185,7 +221,7 @@ View::set_not_visible(Download* download) {
   base_type::erase(itr);
   base_type::push_back(download);
 
-  rpc::parse_command_multiple_d_nothrow(download, m_eventRemoved);
+  received_removed(download);
 }
 
 void
@@ -211,7 +247,7 @@ View::sort() {
   Download* curFocus = focus() != end_visible() ? *focus() : NULL;
 
   // Don't go randomly switching around equivalent elements.
-  std::stable_sort(begin(), end_visible(), view_downloads_compare(m_sortCurrent));
+  std::stable_sort(begin(), end_visible(), view_downloads_compare(m_sortCurrent, &m_sortCurrentExpr));
 
   m_focus = position(std::find(begin(), end_visible(), curFocus));
   emit_changed();
@@ -220,8 +256,8 @@ View::sort() {
 void
 View::filter() {
   // Parition the list in two steps so we know which elements changed.
-  iterator splitVisible  = std::stable_partition(begin_visible(),  end_visible(),  view_downloads_filter(m_filter));
-  iterator splitFiltered = std::stable_partition(begin_filtered(), end_filtered(), view_downloads_filter(m_filter));
+  iterator splitVisible  = std::stable_partition(begin_visible(),  end_visible(),  view_downloads_filter(m_filter, &m_filterExpr));
+  iterator splitFiltered = std::stable_partition(begin_filtered(), end_filtered(), view_downloads_filter(m_filter, &m_filterExpr));
 
   base_type changed(splitVisible, splitFiltered);
   iterator splitChanged = changed.begin() + std::distance(splitVisible, end_visible());
@@ -242,11 +278,11 @@ View::filter() {
   // done by using a base_type* member variable, and making sure we
   // set the elements to NULL as we trigger commands on them. Or
   // perhaps always clear them, thus not throwing anything.
-  if (!m_eventRemoved.empty())
-    std::for_each(changed.begin(), splitChanged, rak::bind2nd(std::ptr_fun(&rpc::parse_command_multiple_d_nothrow), m_eventRemoved));
+  for (iterator itr = changed.begin(); itr != splitChanged; itr++)
+    received_removed(*itr);
 
-  if (!m_eventAdded.empty())
-    std::for_each(splitChanged, changed.end(),   rak::bind2nd(std::ptr_fun(&rpc::parse_command_multiple_d_nothrow), m_eventAdded));
+  for (iterator itr = splitChanged; itr != changed.end(); itr++)
+    received_added(*itr);
 
   emit_changed();
 }
@@ -258,13 +294,13 @@ View::filter_download(core::Download* download) {
   if (itr == base_type::end())
     throw torrent::internal_error("View::filter_download(...) could not find download.");
 
-  if (view_downloads_filter(m_filter)(download)) {
+  if (view_downloads_filter(m_filter, &m_filterExpr)(download)) {
       
     if (itr >= end_visible()) {
       erase_internal(itr);
       insert_visible(download);
 
-      rpc::parse_command_multiple_d_nothrow(download, m_eventAdded);
+      received_added(download);
 
     } else {
       // This makes sure the download is sorted even if it is
@@ -282,12 +318,30 @@ View::filter_download(core::Download* download) {
     erase_internal(itr);
     base_type::push_back(download);
 
-    rpc::parse_command_multiple_d_nothrow(download, m_eventRemoved);
+    received_removed(download);
   }
 
   emit_changed();
 }
 
+void
+View::set_sort_new(const std::string& s) {
+  rpc::expression_from_command(s, &m_sortNewExpr);
+  m_sortNew = s;
+}
+
+void
+View::set_sort_current(const std::string& s) {
+  rpc::expression_from_command(s, &m_sortCurrentExpr);
+  m_sortCurrent = s;
+}
+
+void
+View::set_filter(const std::string& s) {
+  rpc::expression_from_command(s, &m_filterExpr);
+  m_filter = s;
+}
+
 void
 View::set_filter_on_event(const std::string& event) {
   if (std::find(m_events.begin(), m_events.end(), event) != m_events.end())
@@ -307,7 +361,7 @@ View::clear_filter_on() {
 
 inline void
 View::insert_visible(Download* d) {
-  iterator itr = std::find_if(begin_visible(), end_visible(), std::bind1st(view_downloads_compare(m_sortNew), d));
+  iterator itr = std::find_if(begin_visible(), end_visible(), std::bind1st(view_downloads_compare(m_sortNew, &m_sortNewExpr), d));
 
   m_size++;
   m_focus += (m_focus >= position(itr));
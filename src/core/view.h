@@ -49,13 +49,17 @@
 #ifndef RTORRENT_CORE_VIEW_DOWNLOADS_H
 #define RTORRENT_CORE_VIEW_DOWNLOADS_H
 
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
+#include <inttypes.h>
 #include <rak/timer.h>
 #include <sigc++/signal.h>
 
 #include "globals.h"
+#include "rpc/command_compiled.h"
+#include "rpc/expression.h"
 
 namespace core {
 
@@ -67,6 +71,12 @@ public:
   typedef std::vector<std::string>       event_list_type;
   typedef sigc::signal0<void>            signal_type;
 
+  // Hex info hashes of downloads that left the visible part of the
+  // view, tagged with the DownloadList generation they left at.
+  typedef std::deque<std::pair<uint64_t, std::string> > removed_list;
+
+  static const unsigned int max_removed_size = 1024;
+
   using base_type::iterator;
   using base_type::const_iterator;
   using base_type::reverse_iterator;
@@ -74,7 +84,7 @@ public:
   
   using base_type::size_type;
 
-  View() {}
+  View() : m_removedTrimmed(0) {}
   ~View();
 
   void                initialize(const std::string& name);
@@ -115,23 +125,25 @@ public:
 
   void                sort();
 
-  void                set_sort_new(const std::string& s)      { m_sortNew = s; }
-  void                set_sort_current(const std::string& s)  { m_sortCurrent = s; }
+  // Commands of the form 'expr=...' are compiled into an
+  // rpc::Expression when set.
+  void                set_sort_new(const std::string& s);
+  void                set_sort_current(const std::string& s);
 
   // Need to explicity trigger filtering.
   void                filter();
   void                filter_download(core::Download* download);
 
   const std::string&  get_filter() const { return m_filter; }
-  void                set_filter(const std::string& s)        { m_filter = s; }
+  void                set_filter(const std::string& s);
   void                set_filter_on_event(const std::string& event);
 
   void                clear_filter_on();
 
-  const std::string&  get_event_added() const { return m_eventAdded; }
-  const std::string&  get_event_removed() const { return m_eventRemoved; }
-  void                set_event_added(const std::string& cmd)   { m_eventAdded = cmd; }
-  void                set_event_removed(const std::string& cmd) { m_eventRemoved = cmd; }
+  const std::string&  get_event_added() const { return m_eventAdded.command(); }
+  const std::string&  get_event_removed() const { return m_eventRemoved.command(); }
+  void                set_event_added(const std::string& cmd)   { m_eventAdded.set_command(cmd); }
+  void                set_event_removed(const std::string& cmd) { m_eventRemoved.set_command(cmd); }
 
   // The time of the last change to the view, semantics of this is
   // user-dependent. Used by f.ex. ViewManager to decide if it should
@@ -142,6 +154,12 @@ public:
   rak::timer          last_changed() const                                 { return m_lastChanged; }
   void                set_last_changed(const rak::timer& t = ::cachedTime) { m_lastChanged = t; }
 
+  // Used by d.multicall.since to tell clients which rows to drop.
+  // Cursors older than 'removed_trimmed()' can't be served a
+  // complete list.
+  const removed_list& removed() const                         { return m_removed; }
+  uint64_t            removed_trimmed() const                 { return m_removedTrimmed; }
+
   // Don't connect any slots until after initialize else it get's
   // triggered when adding the Download's in DownloadList.
   signal_type&        signal_changed()                        { return m_signalChanged; }
@@ -157,6 +175,9 @@ private:
 
   inline void         emit_changed();
 
+  void                received_added(Download* d);
+  void                received_removed(Download* d);
+
   size_type           position(const_iterator itr) const      { return itr - begin(); }
 
   // An received thing for changed status so we can sort and filter.
@@ -169,15 +190,21 @@ private:
   // These should be replaced by a faster non-string command type.
   std::string         m_sortNew;
   std::string         m_sortCurrent;
+  rpc::Expression     m_sortNewExpr;
+  rpc::Expression     m_sortCurrentExpr;
 
   std::string         m_filter;
+  rpc::Expression     m_filterExpr;
   event_list_type     m_events;
 
-  std::string         m_eventAdded;
-  std::string         m_eventRemoved;
+  rpc::CommandCompiled m_eventAdded;
+  rpc::CommandCompiled m_eventRemoved;
 
   rak::timer          m_lastChanged;
 
+  removed_list        m_removed;
+  uint64_t            m_removedTrimmed;
+
   signal_type         m_signalChanged;
   rak::priority_item  m_delayChanged;
 };
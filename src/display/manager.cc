@@ -51,6 +51,7 @@ Manager::Manager() :
   m_forceRedraw(false) {
 
   m_taskUpdate.set_slot(rak::mem_fn(this, &Manager::receive_update));
+  m_taskUpdate.set_name("display.update");
 }
 
 Manager::~Manager() {
@@ -60,6 +60,7 @@ Window::Window(Canvas* canvas, int flags, extent_type minWidth, extent_type minH
   m_maxHeight(maxHeight) {
 
   m_taskUpdate.set_slot(rak::mem_fn(this, &Window::redraw));
+  m_taskUpdate.set_name("display.window");
 }
 
 Window::~Window() {
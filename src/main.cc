@@ -36,6 +36,7 @@
 
 #include "config.h"
 
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <string>
@@ -43,17 +44,20 @@
 #include <torrent/http.h>
 #include <torrent/torrent.h>
 #include <torrent/exceptions.h>
+#include <torrent/object.h>
 #include <rak/functional.h>
 
 #ifdef USE_EXECINFO
 #include <execinfo.h>
 #endif
 
+#include "core/clock.h"
 #include "core/dht_manager.h"
 #include "core/download.h"
 #include "core/download_factory.h"
 #include "core/download_store.h"
 #include "core/manager.h"
+#include "core/profiler.h"
 #include "display/canvas.h"
 #include "display/window.h"
 #include "display/manager.h"
@@ -61,6 +65,7 @@
 
 #include "rpc/command_scheduler.h"
 #include "rpc/command_scheduler_item.h"
+#include "rpc/parse.h"
 #include "rpc/parse_commands.h"
 #include "utils/directory.h"
 
@@ -71,10 +76,23 @@
 
 void do_panic(int signum);
 void print_help();
+void print_simulation(const torrent::Object& result);
 void set_no_gui();
 void daemonize();
 void initialize_commands();
 
+// Seconds to fast-forward the scheduler by in the '-S' test mode,
+// zero when running normally.
+int64_t simulate_seconds = 0;
+
+void
+set_simulate(const std::string& arg) {
+  rpc::parse_whole_value(arg.c_str(), &simulate_seconds);
+
+  if (simulate_seconds <= 0)
+    throw torrent::input_error("Invalid simulation duration.");
+}
+
 int
 parse_options(Control* c, int argc, char** argv) {
   try {
@@ -91,6 +109,7 @@ parse_options(Control* c, int argc, char** argv) {
     optionParser.insert_option('i', sigc::bind<0>(sigc::ptr_fun(&rpc::call_command_set_string), "ip"));
     optionParser.insert_option('p', sigc::bind<0>(sigc::ptr_fun(&rpc::call_command_set_string), "port_range"));
     optionParser.insert_option('s', sigc::bind<0>(sigc::ptr_fun(&rpc::call_command_set_string), "session"));
+    optionParser.insert_option('S', sigc::ptr_fun(&set_simulate));
 
     optionParser.insert_option('O', sigc::ptr_fun(&rpc::parse_command_single_std));
     optionParser.insert_option_list('o', sigc::ptr_fun(&rpc::call_command_set_std_string));
@@ -178,6 +197,8 @@ main(int argc, char** argv) {
     // torrent::ConnectionManager* are valid etc.
     initialize_commands();
 
+    rak::timer configStart = rak::timer::current();
+
     rpc::parse_command_multiple
       (rpc::make_target(),
 //        "system.method.insert = test.value,value\n"
@@ -208,6 +229,20 @@ main(int argc, char** argv) {
 
        "system.method.set_key = event.download.erased, !_download_list, ui.unfocus_download=\n"
        "system.method.set_key = event.download.erased, ~_delete_tied, d.delete_tied=\n"
+       "system.method.set_key = event.download.erased, !_queue, scheduler.queue.removed=\n"
+       "system.method.set_key = event.download.finished, !_queue, scheduler.queue.finished=\n"
+       "system.method.set_key = event.download.paused,   !_queue, scheduler.queue.paused=\n"
+       "system.method.set_key = event.download.resumed,  !_queue, scheduler.queue.resumed=\n"
+
+       "system.method.set_key = event.download.opened,    !_generation, d.bump_generation=\n"
+       "system.method.set_key = event.download.closed,    !_generation, d.bump_generation=\n"
+       "system.method.set_key = event.download.resumed,   !_generation, d.bump_generation=\n"
+       "system.method.set_key = event.download.paused,    !_generation, d.bump_generation=\n"
+       "system.method.set_key = event.download.finished,  !_generation, d.bump_generation=\n"
+       "system.method.set_key = event.download.hash_done, !_generation, d.bump_generation=\n"
+
+       "system.method.set_key = event.download.hash_queued, !_metainfo, d.metainfo.restore=\n"
+       "system.method.set_key = event.download.hash_done,   ~_metainfo, d.metainfo.release=\n"
 
        "system.method.insert = ratio.enable, simple|static|const,group.seeding.ratio.enable=\n"
        "system.method.insert = ratio.disable,simple|static|const,group.seeding.ratio.disable=\n"
@@ -289,11 +324,19 @@ main(int argc, char** argv) {
        "encryption=allow_incoming,prefer_plaintext,enable_retry\n"
     );
 
+    rak::timer configBuiltin = rak::timer::current();
+
     if (OptionParser::has_flag('n', argc, argv))
       control->core()->push_log("Ignoring ~/.rtorrent.rc.");
     else
       rpc::parse_command_single(rpc::make_target(), "try_import = ~/.rtorrent.rc");
 
+    char configBuffer[128];
+    snprintf(configBuffer, 128, "Loaded configuration in %u ms, built-in commands took %u ms.",
+             (unsigned int)((rak::timer::current() - configStart).usec() / 1000),
+             (unsigned int)((configBuiltin - configStart).usec() / 1000));
+    control->core()->push_log(configBuffer);
+
     int firstArg = parse_options(control, argc, argv);
 
     control->initialize();
@@ -312,6 +355,22 @@ main(int argc, char** argv) {
     control->display()->adjust_layout();
     control->display()->receive_update();
 
+    // Test mode, run the scheduled tasks on a simulated clock and exit
+    // without touching the session directory.
+    if (simulate_seconds != 0) {
+      control->core()->download_store()->disable();
+
+      torrent::Object result = core::Clock().simulate(&taskScheduler, rak::timer::from_seconds(simulate_seconds));
+
+      control->cleanup();
+      print_simulation(result);
+
+      delete control;
+      delete this_thread;
+
+      return 0;
+    }
+
     while (!control->is_shutdown_completed()) {
       if (control->is_shutdown_received())
         control->handle_shutdown();
@@ -319,9 +378,10 @@ main(int argc, char** argv) {
       control->inc_tick();
 
       cachedTime = rak::timer::current();
-      rak::priority_queue_perform(&taskScheduler, cachedTime);
+      control->profiler()->perform_tasks(&taskScheduler, cachedTime);
 
       // Do shutdown check before poll, not after.
+      core::ProfileScope profileScope(control->profiler(), "poll");
       this_thread->poll_manager()->poll(client_next_timeout(control));
     }
 
@@ -385,6 +445,7 @@ print_help() {
   std::cout << "  -p <int>-<int>    Set port range for incoming connections" << std::endl;
   std::cout << "  -d <directory>    Save torrents to this directory by default" << std::endl;
   std::cout << "  -s <directory>    Set the session directory" << std::endl;
+  std::cout << "  -S <seconds>      Fast-forward scheduled tasks on a simulated clock and exit" << std::endl;
   std::cout << "  -o key=opt,...    Set options, see 'rtorrent.rc' file" << std::endl;
   std::cout << std::endl;
   std::cout << "Main view keys:" << std::endl;
@@ -430,3 +491,18 @@ void
 set_no_gui() {
    display::Canvas::use_gui(false);
 }
+
+void
+print_simulation(const torrent::Object& result) {
+  const torrent::Object::map_type& tasks = result.get_key("tasks").as_map();
+
+  for (torrent::Object::map_const_iterator itr = tasks.begin(), last = tasks.end(); itr != last; itr++)
+    std::cout << itr->first << ": "
+              << itr->second.get_key("calls").as_value() << " calls, "
+              << itr->second.get_key("usec").as_value() << " usec, "
+              << itr->second.get_key("max_usec").as_value() << " max usec" << std::endl;
+
+  std::cout << "Simulated " << result.get_key("simulated_usec").as_value() / 1000000 << " seconds with "
+            << result.get_key("calls").as_value() << " calls in "
+            << result.get_key("usec").as_value() / 1000 << " ms." << std::endl;
+}
@@ -0,0 +1,84 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <rak/path.h>
+#include <torrent/exceptions.h>
+
+#include "capture.h"
+
+namespace rpc {
+
+void
+CaptureLog::open(const std::string& filename) {
+  close();
+
+  if ((m_fd = ::open(rak::path_expand(filename).c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644)) == -1)
+    throw torrent::input_error("Could not open RPC capture file.");
+}
+
+void
+CaptureLog::close() {
+  if (m_fd == -1)
+    return;
+
+  ::close(m_fd);
+  m_fd = -1;
+}
+
+void
+CaptureLog::write(int64_t timeUsec, int64_t latencyUsec, bool mutated,
+                  const char* request, uint32_t length, uint32_t responseLength) {
+  if (m_fd == -1)
+    return;
+
+  char header[128];
+  int headerSize = snprintf(header, sizeof(header), "rpc %lli %lli %i %u %u\n",
+                            (long long int)timeUsec, (long long int)latencyUsec, (int)mutated, length, responseLength);
+
+  // A short write leaves a truncated record, which the replay will
+  // reject, so there's no point in retrying.
+  if (::write(m_fd, header, headerSize) != headerSize ||
+      ::write(m_fd, request, length) != (ssize_t)length ||
+      ::write(m_fd, "\n", 1) != 1)
+    close();
+}
+
+}
@@ -0,0 +1,76 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_CAPTURE_H
+#define RTORRENT_RPC_CAPTURE_H
+
+#include <string>
+#include <inttypes.h>
+
+namespace rpc {
+
+// Captured RPC traffic is stored as a sequence of records, each a
+// header line followed by the raw request body and a newline:
+//
+//   rpc <time_usec> <latency_usec> <mutated> <request_size> <response_size>\n
+//   <request>\n
+//
+// 'mutated' is set if the request called a command that isn't
+// read-only, which makes it unsafe to replay on a live client.
+
+class CaptureLog {
+public:
+  CaptureLog() : m_fd(-1) {}
+  ~CaptureLog() { close(); }
+
+  bool                is_open() const { return m_fd != -1; }
+
+  void                open(const std::string& filename);
+  void                close();
+
+  void                write(int64_t timeUsec, int64_t latencyUsec, bool mutated,
+                            const char* request, uint32_t length, uint32_t responseLength);
+
+private:
+  CaptureLog(const CaptureLog&);
+  void operator = (const CaptureLog&);
+
+  int                 m_fd;
+};
+
+}
+
+#endif
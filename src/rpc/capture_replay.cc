@@ -0,0 +1,198 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <rak/path.h>
+#include <torrent/exceptions.h>
+
+#include "globals.h"
+
+#include "capture_replay.h"
+#include "parse_commands.h"
+#include "xmlrpc.h"
+
+namespace rpc {
+
+CaptureReplay::CaptureReplay() :
+  m_position(0),
+  m_running(false),
+  m_speed(1),
+  m_mutating(false),
+  m_skipped(0),
+  m_bytes(0) {
+
+  m_task.set_slot(rak::mem_fn(this, &CaptureReplay::receive_next));
+  m_task.set_name("rpc.replay");
+}
+
+CaptureReplay::~CaptureReplay() {
+  priority_queue_erase(&taskScheduler, &m_task);
+}
+
+void
+CaptureReplay::start(const std::string& filename, int64_t speed, bool mutating) {
+  if (speed < 0)
+    throw torrent::input_error("Invalid replay speed.");
+
+  std::fstream file(rak::path_expand(filename).c_str(), std::ios::in | std::ios::binary);
+
+  if (!file.is_open())
+    throw torrent::input_error("Could not open RPC capture file.");
+
+  if (xmlrpc.capture()->is_open())
+    throw torrent::input_error("Cannot replay RPC traffic while capturing.");
+
+  record_list records;
+  std::string header;
+
+  while (std::getline(file, header)) {
+    long long int timeUsec, latencyUsec;
+    int           mutated;
+    unsigned int  requestSize, responseSize;
+
+    if (std::sscanf(header.c_str(), "rpc %lli %lli %i %u %u", &timeUsec, &latencyUsec, &mutated, &requestSize, &responseSize) != 5)
+      throw torrent::input_error("Invalid record in RPC capture file.");
+
+    record_type& record = *records.insert(records.end(), record_type());
+    record.m_time = timeUsec;
+    record.m_mutated = mutated;
+    record.m_request.resize(requestSize);
+
+    if (!file.read(&*record.m_request.begin(), requestSize) || file.get() != '\n')
+      throw torrent::input_error("Truncated record in RPC capture file.");
+  }
+
+  stop();
+
+  m_records.swap(records);
+  m_position = 0;
+  m_speed = speed;
+  m_mutating = mutating;
+
+  m_start = cachedTime;
+  m_finished = rak::timer();
+  m_skipped = 0;
+  m_bytes = 0;
+  m_latency = core::ProfileHistogram();
+
+  m_running = true;
+  schedule_next();
+}
+
+void
+CaptureReplay::stop() {
+  priority_queue_erase(&taskScheduler, &m_task);
+  m_running = false;
+
+  if (m_finished == rak::timer() && !m_records.empty())
+    m_finished = cachedTime;
+}
+
+torrent::Object
+CaptureReplay::status() const {
+  torrent::Object result = torrent::Object::create_map();
+
+  int64_t elapsed = ((m_finished != rak::timer() ? m_finished : cachedTime) - m_start).usec();
+
+  result.insert_key("active",       (int64_t)is_active());
+  result.insert_key("records",      (int64_t)m_records.size());
+  result.insert_key("position",     (int64_t)m_position);
+  result.insert_key("replayed",     (int64_t)m_latency.count());
+  result.insert_key("skipped",      (int64_t)m_skipped);
+  result.insert_key("bytes",        (int64_t)m_bytes);
+  result.insert_key("elapsed_usec", elapsed);
+  result.insert_key("rate",         elapsed > 0 ? (int64_t)(m_latency.count() * 1000000 / elapsed) : (int64_t)0);
+  result.insert_key("p50_usec",     (int64_t)m_latency.percentile(50));
+  result.insert_key("p90_usec",     (int64_t)m_latency.percentile(90));
+  result.insert_key("p99_usec",     (int64_t)m_latency.percentile(99));
+  result.insert_key("max_usec",     (int64_t)m_latency.max());
+
+  return result;
+}
+
+void
+CaptureReplay::receive_next() {
+  // Copied as a replayed request may load another capture.
+  record_type record = m_records[m_position++];
+
+  if (!record.m_mutated || m_mutating) {
+    XmlRpc::slot_write slotWrite;
+    slotWrite.set(rak::mem_fn(this, &CaptureReplay::receive_write));
+
+    rak::timer start = rak::timer::current();
+    xmlrpc.process(record.m_request.c_str(), record.m_request.size(), slotWrite);
+
+    int64_t latency = (rak::timer::current() - start).usec();
+    m_latency.insert(latency < 0 ? 0 : latency);
+
+  } else {
+    m_skipped++;
+  }
+
+  // The replayed request might have stopped or restarted the replay.
+  if (m_running && !m_task.is_queued())
+    schedule_next();
+}
+
+bool
+CaptureReplay::receive_write(const char* buffer, uint32_t length) {
+  m_bytes += length;
+  return true;
+}
+
+void
+CaptureReplay::schedule_next() {
+  if (m_position == m_records.size()) {
+    m_finished = cachedTime;
+    m_running = false;
+    return;
+  }
+
+  // Always leave the current main loop iteration so the replay
+  // competes with other work the same way real requests would.
+  rak::timer next = cachedTime + rak::timer(1);
+
+  if (m_speed != 0)
+    next = std::max(next, m_start + rak::timer((m_records[m_position].m_time - m_records.front().m_time) / m_speed));
+
+  priority_queue_insert(&taskScheduler, &m_task, next);
+}
+
+}
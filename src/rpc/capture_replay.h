@@ -0,0 +1,102 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_CAPTURE_REPLAY_H
+#define RTORRENT_RPC_CAPTURE_REPLAY_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <rak/priority_queue_default.h>
+#include <torrent/object.h>
+
+#include "core/profiler.h"
+
+namespace rpc {
+
+// Feeds a capture file back through XmlRpc::process, either at the
+// recorded pace scaled by 'speed' or, with a speed of zero, one
+// request per main loop iteration. Requests that mutated state are
+// skipped unless explicitly included.
+
+class CaptureReplay {
+public:
+  struct record_type {
+    int64_t           m_time;
+    bool              m_mutated;
+    std::string       m_request;
+  };
+
+  typedef std::vector<record_type> record_list;
+
+  CaptureReplay();
+  ~CaptureReplay();
+
+  bool                is_active() const { return m_running; }
+
+  void                start(const std::string& filename, int64_t speed, bool mutating);
+  void                stop();
+
+  torrent::Object     status() const;
+
+private:
+  CaptureReplay(const CaptureReplay&);
+  void operator = (const CaptureReplay&);
+
+  void                receive_next();
+  bool                receive_write(const char* buffer, uint32_t length);
+
+  void                schedule_next();
+
+  record_list         m_records;
+  record_list::size_type m_position;
+
+  bool                m_running;
+  int64_t             m_speed;
+  bool                m_mutating;
+
+  rak::timer          m_start;
+  rak::timer          m_finished;
+  uint64_t            m_skipped;
+  uint64_t            m_bytes;
+
+  core::ProfileHistogram m_latency;
+  rak::priority_item  m_task;
+};
+
+}
+
+#endif
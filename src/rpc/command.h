@@ -130,18 +130,39 @@ public:
   Command() {}
   virtual ~Command() {}
 
-  static torrent::Object* argument(unsigned int index) { return m_arguments + index; }
-
 protected:
   Command(const Command&);
   void operator = (const Command&);
+};
+
+// Arguments of a callable command string, for use by the
+// 'argument.N' placeholders within it. Frames live on the stack of
+// the call and only reference the caller's arguments, so nothing is
+// copied. Positions the call didn't supply fall through to the
+// enclosing frame.
+//
+// The innermost frame is static rather than passed through every
+// command slot, so frames may only be used by the main thread, which
+// is the only one executing commands. XMLRPC workers just decode and
+// encode. Using a frame from any other thread throws internal_error.
+class ArgumentFrame {
+public:
+  ArgumentFrame(const torrent::Object& args);
+  ~ArgumentFrame() { m_current = m_parent; }
+
+  // Returns NULL if no frame holds the argument.
+  static const torrent::Object* find(unsigned int index);
+
+private:
+  ArgumentFrame(const ArgumentFrame&);
+  void operator = (const ArgumentFrame&);
+
+  static void            check_thread();
 
-  // For use by functions that need to use placeholders to arguments
-  // within commands. E.d. callable command strings where one of the
-  // arguments within the command needs to be supplied by the caller.
-  static const unsigned int max_arguments = 10;
+  const torrent::Object* m_args;
+  ArgumentFrame*         m_parent;
 
-  static torrent::Object m_arguments[max_arguments];
+  static ArgumentFrame*  m_current;
 };
 
 template <typename T1 = void, typename T2 = void>
@@ -0,0 +1,183 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <torrent/exceptions.h>
+
+#include "parse_commands.h"
+#include "command_compiled.h"
+
+namespace rpc {
+
+// Mirrors the strings parse_command_execute() would replace, so that
+// arguments without any '$' can be passed on without copying.
+static bool
+command_compiled_has_execute(const torrent::Object& args) {
+  if (args.is_string())
+    return *args.as_string().c_str() == '$';
+
+  if (!args.is_list())
+    return false;
+
+  for (torrent::Object::list_const_iterator itr = args.as_list().begin(), last = args.as_list().end(); itr != last; itr++)
+    if (itr->is_string() && *itr->as_string().c_str() == '$')
+      return true;
+
+  return false;
+}
+
+void
+CommandCompiled::set_command(const std::string& cmd) {
+  if (m_calling != 0) {
+    m_pendingCommand = cmd;
+    m_pending = true;
+    return;
+  }
+
+  if (m_compiled && cmd == m_command)
+    return;
+
+  m_command = cmd;
+  m_compiled = false;
+  m_instructions.clear();
+
+  const char* first = m_command.c_str();
+  const char* last = m_command.c_str() + m_command.size();
+
+  try {
+    instruction_list instructions;
+
+    while (first != last) {
+      instruction tmp;
+
+      first = parse_command_split(first, last, &tmp.m_key, &tmp.m_args);
+
+      // Only leading and trailing whitespace or a comment remain.
+      if (tmp.m_key.empty())
+        break;
+
+      tmp.m_execute = command_compiled_has_execute(tmp.m_args);
+      tmp.m_itr = commands.end();
+      tmp.m_generation = commands.generation();
+
+      instructions.push_back(tmp);
+    }
+
+    m_instructions.swap(instructions);
+    m_compiled = true;
+
+  } catch (torrent::input_error&) {
+  }
+}
+
+bool
+CommandCompiled::resolve(instruction* inst) {
+  if (inst->m_itr == commands.end() || inst->m_generation != commands.generation()) {
+    inst->m_itr = commands.find(inst->m_key.c_str());
+    inst->m_generation = commands.generation();
+  }
+
+  return inst->m_itr != commands.end();
+}
+
+torrent::Object
+CommandCompiled::call(target_type target) {
+  torrent::Object result;
+
+  m_calling++;
+
+  try {
+    call_instructions(target).swap(result);
+  } catch (...) {
+    call_finished();
+    throw;
+  }
+
+  call_finished();
+  return result;
+}
+
+void
+CommandCompiled::call_finished() {
+  if (--m_calling != 0 || !m_pending)
+    return;
+
+  std::string cmd;
+  cmd.swap(m_pendingCommand);
+
+  m_pending = false;
+  set_command(cmd);
+}
+
+torrent::Object
+CommandCompiled::call_instructions(target_type target) {
+  if (!m_compiled)
+    return parse_command_multiple(target, m_command.c_str(), m_command.c_str() + m_command.size());
+
+  torrent::Object result;
+
+  for (instruction_list::iterator itr = m_instructions.begin(), last = m_instructions.end(); itr != last; itr++) {
+    if (!resolve(&*itr))
+      throw torrent::input_error("Command \"" + itr->m_key + "\" does not exist.");
+
+    if (itr->m_execute) {
+      torrent::Object args = itr->m_args;
+      parse_command_execute(target, &args);
+
+      result = commands.call_command(itr->m_itr, args, target);
+
+    } else {
+      result = commands.call_command(itr->m_itr, itr->m_args, target);
+    }
+  }
+
+  return result;
+}
+
+bool
+CommandCompiled::is_read_only() {
+  if (!m_compiled)
+    return false;
+
+  for (instruction_list::iterator itr = m_instructions.begin(), last = m_instructions.end(); itr != last; itr++)
+    if (itr->m_execute || !resolve(&*itr) || !commands.is_read_only(itr->m_itr))
+      return false;
+
+  return true;
+}
+
+}
@@ -0,0 +1,107 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_COMMAND_COMPILED_H
+#define RTORRENT_RPC_COMMAND_COMPILED_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <torrent/object.h>
+
+#include "command_map.h"
+
+namespace rpc {
+
+// A stored command string together with its parsed form, so that
+// methods, event hooks, schedules and view events don't re-parse the
+// string every time they are called. The string is only compiled when
+// it changes.
+//
+// Keys are looked up on the first call and again after any command
+// has been erased. Strings that fail to parse are parsed on every call
+// as before, so the error is reported at the same point.
+//
+// A command may set a new string on the object that is calling it,
+// e.g. a method that redefines itself. The string is then kept aside
+// and compiled once the outermost call has returned.
+
+class CommandCompiled {
+public:
+  CommandCompiled() : m_compiled(true), m_calling(0), m_pending(false) {}
+  explicit CommandCompiled(const std::string& cmd) : m_compiled(false), m_calling(0), m_pending(false) { set_command(cmd); }
+
+  bool                is_compiled() const                 { return m_compiled; }
+  bool                empty() const                       { return command().empty(); }
+
+  const std::string&  command() const                     { return m_pending ? m_pendingCommand : m_command; }
+  void                set_command(const std::string& cmd);
+
+  torrent::Object     call(target_type target);
+
+  // True if every command is flagged read-only and no argument needs
+  // '$' expansion, meaning calls can't change any state.
+  bool                is_read_only();
+
+private:
+  struct instruction {
+    std::string                m_key;
+    torrent::Object            m_args;
+    bool                       m_execute;
+
+    CommandMap::const_iterator m_itr;
+    uint32_t                   m_generation;
+  };
+
+  typedef std::vector<instruction> instruction_list;
+
+  static bool         resolve(instruction* inst);
+
+  torrent::Object     call_instructions(target_type target);
+  void                call_finished();
+
+  std::string         m_command;
+  bool                m_compiled;
+  instruction_list    m_instructions;
+
+  unsigned int        m_calling;
+  bool                m_pending;
+  std::string         m_pendingCommand;
+};
+
+}
+
+#endif
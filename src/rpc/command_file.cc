@@ -0,0 +1,337 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <rak/path.h>
+#include <torrent/exceptions.h>
+#include <torrent/object_stream.h>
+
+#include "parse_commands.h"
+#include "command_file.h"
+
+namespace rpc {
+
+// Bump when the layout of the cached commands changes.
+static const int64_t command_file_cache_version = 1;
+
+// Maps the whole file into memory, falling back to reading it for
+// empty files and anything that isn't a regular file, such as pipes.
+class command_file_map {
+public:
+  command_file_map() : m_data(NULL), m_size(0), m_mtime(0), m_mapped(false) {}
+  ~command_file_map() { close(); }
+
+  bool                open(const char* path);
+  void                close();
+
+  const char*         begin() const { return m_data; }
+  const char*         end() const   { return m_data + m_size; }
+
+  size_t              size() const  { return m_size; }
+  int64_t             mtime() const { return m_mtime; }
+
+private:
+  command_file_map(const command_file_map&);
+  void operator = (const command_file_map&);
+
+  const char*         m_data;
+  size_t              m_size;
+  int64_t             m_mtime;
+  bool                m_mapped;
+
+  std::string         m_buffer;
+};
+
+bool
+command_file_map::open(const char* path) {
+  int fd = ::open(path, O_RDONLY);
+
+  if (fd == -1)
+    return false;
+
+  struct stat sb;
+
+  if (::fstat(fd, &sb) == -1) {
+    ::close(fd);
+    return false;
+  }
+
+  m_mtime = sb.st_mtime;
+
+  if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    void* data = ::mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data != MAP_FAILED) {
+      ::madvise(data, sb.st_size, MADV_SEQUENTIAL);
+      ::close(fd);
+
+      m_data = static_cast<const char*>(data);
+      m_size = sb.st_size;
+      m_mapped = true;
+      return true;
+    }
+  }
+
+  char buffer[4096];
+  ssize_t length;
+
+  while ((length = ::read(fd, buffer, sizeof(buffer))) > 0)
+    m_buffer.append(buffer, length);
+
+  ::close(fd);
+
+  if (length == -1)
+    return false;
+
+  m_data = m_buffer.c_str();
+  m_size = m_buffer.size();
+  return true;
+}
+
+void
+command_file_map::close() {
+  if (m_mapped)
+    ::munmap(const_cast<char*>(m_data), m_size);
+
+  m_data = NULL;
+  m_size = 0;
+  m_mapped = false;
+  m_buffer.clear();
+}
+
+// FNV-1a, only used to notice changes that keep the size and
+// modification time.
+static uint32_t
+command_file_hash(const char* first, const char* last) {
+  uint32_t hash = 2166136261u;
+
+  while (first != last) {
+    hash ^= (unsigned char)*first++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+bool
+CommandFile::load(const std::string& path, const std::string& cachePath) {
+  command_file_map file;
+
+  if (!file.open(rak::path_expand(path).c_str()))
+    return false;
+
+  m_path = path;
+  m_size = file.size();
+  m_mtime = file.mtime();
+  m_hash = command_file_hash(file.begin(), file.end());
+  m_commands.clear();
+
+  m_cached = !cachePath.empty() && read_cache(cachePath);
+
+  if (m_cached)
+    return true;
+
+  compile(file.begin(), file.end());
+
+  // A cache that can't be written only means the file gets parsed
+  // again next time.
+  if (!cachePath.empty())
+    write_cache(cachePath);
+
+  return true;
+}
+
+void
+CommandFile::compile(const char* first, const char* last) {
+  uint32_t lineNumber = 0;
+  std::string joined;
+
+  while (first != last) {
+    const char* lineLast = std::find(first, last, '\n');
+    const char* next = lineLast != last ? lineLast + 1 : last;
+
+    int escaped = parse_count_escaped(first, lineLast);
+
+    lineNumber++;
+
+    if (escaped & 0x1) {
+      // Remove the escape characters and continue with the next line.
+      joined.append(first, lineLast - escaped);
+      first = next;
+      continue;
+    }
+
+    // Lines are parsed in place unless they were continued, or are the
+    // last line of a mapped file that needn't be followed by anything
+    // readable.
+    const char* cmdFirst = first;
+    const char* cmdLast = lineLast;
+
+    if (!joined.empty() || lineLast == last) {
+      joined.append(first, lineLast);
+
+      cmdFirst = joined.c_str();
+      cmdLast = joined.c_str() + joined.size();
+    }
+
+    m_commands.push_back(command_type());
+    m_commands.back().m_line = lineNumber;
+
+    try {
+      parse_command_split(cmdFirst, cmdLast, &m_commands.back().m_key, &m_commands.back().m_args);
+    } catch (torrent::input_error& e) {
+      throw_error(lineNumber, e.what());
+    }
+
+    if (m_commands.back().m_key.empty())
+      m_commands.pop_back();
+
+    joined.clear();
+    first = next;
+  }
+}
+
+void
+CommandFile::call(target_type target) {
+  for (command_list::const_iterator itr = m_commands.begin(), last = m_commands.end(); itr != last; itr++) {
+    try {
+      torrent::Object args = itr->m_args;
+
+      parse_command_execute(target, &args);
+      commands.call_command(itr->m_key.c_str(), args, target);
+
+    } catch (torrent::input_error& e) {
+      throw_error(itr->m_line, e.what());
+    }
+  }
+}
+
+bool
+CommandFile::read_cache(const std::string& cachePath) {
+  std::fstream f(cachePath.c_str(), std::ios::in | std::ios::binary);
+
+  if (!f.is_open())
+    return false;
+
+  torrent::Object cache;
+  f >> cache;
+
+  if (!f.good() || !cache.is_map() ||
+      !cache.has_key_value("version") || cache.get_key_value("version") != command_file_cache_version ||
+      !cache.has_key_value("size") || cache.get_key_value("size") != m_size ||
+      !cache.has_key_value("mtime") || cache.get_key_value("mtime") != m_mtime ||
+      !cache.has_key_value("hash") || cache.get_key_value("hash") != m_hash ||
+      !cache.has_key("commands") || !cache.get_key("commands").is_list())
+    return false;
+
+  const torrent::Object::list_type& entries = cache.get_key("commands").as_list();
+  command_list commandList;
+
+  commandList.reserve(entries.size());
+
+  for (torrent::Object::list_const_iterator itr = entries.begin(), last = entries.end(); itr != last; itr++) {
+    if (!itr->is_list() || itr->as_list().size() != 3)
+      return false;
+
+    torrent::Object::list_const_iterator fieldItr = itr->as_list().begin();
+    const torrent::Object& line = *fieldItr++;
+    const torrent::Object& key = *fieldItr++;
+    const torrent::Object& args = *fieldItr++;
+
+    if (!line.is_value() || !key.is_string() || !(args.is_string() || args.is_list()))
+      return false;
+
+    commandList.push_back(command_type());
+    commandList.back().m_line = line.as_value();
+    commandList.back().m_key = key.as_string();
+    commandList.back().m_args = args;
+  }
+
+  m_commands.swap(commandList);
+  return true;
+}
+
+bool
+CommandFile::write_cache(const std::string& cachePath) const {
+  torrent::Object cache = torrent::Object::create_map();
+
+  cache.insert_key("version", command_file_cache_version);
+  cache.insert_key("size", m_size);
+  cache.insert_key("mtime", m_mtime);
+  cache.insert_key("hash", (int64_t)m_hash);
+
+  torrent::Object::list_type& entries = cache.insert_key("commands", torrent::Object::create_list()).as_list();
+
+  for (command_list::const_iterator itr = m_commands.begin(), last = m_commands.end(); itr != last; itr++) {
+    torrent::Object::list_type& entry = entries.insert(entries.end(), torrent::Object::create_list())->as_list();
+
+    entry.push_back((int64_t)itr->m_line);
+    entry.push_back(itr->m_key);
+    entry.push_back(itr->m_args);
+  }
+
+  std::fstream f((cachePath + ".new").c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+
+  if (!f.is_open())
+    return false;
+
+  f << cache;
+
+  if (!f.good())
+    return false;
+
+  f.close();
+
+  return ::rename((cachePath + ".new").c_str(), cachePath.c_str()) == 0;
+}
+
+void
+CommandFile::throw_error(uint32_t line, const char* msg) const {
+  char buffer[2048];
+  snprintf(buffer, 2048, "Error in option file: %s:%u: %s", m_path.c_str(), line, msg);
+
+  throw torrent::input_error(buffer);
+}
+
+}
@@ -0,0 +1,102 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_COMMAND_FILE_H
+#define RTORRENT_RPC_COMMAND_FILE_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <torrent/object.h>
+
+#include "command_map.h"
+
+namespace rpc {
+
+// A resource file split into its commands. The file is mapped into
+// memory and parsed in one pass, so there is no limit on the length
+// of a line.
+//
+// When a cache path is given, the parsed commands are written there
+// in bencode together with the size, modification time and a hash of
+// the file, and read back instead of parsing the file again as long
+// as those haven't changed.
+
+class CommandFile {
+public:
+  struct command_type {
+    uint32_t         m_line;
+    std::string      m_key;
+    torrent::Object  m_args;
+  };
+
+  typedef std::vector<command_type> command_list;
+
+  CommandFile() : m_size(0), m_mtime(0), m_hash(0), m_cached(false) {}
+
+  const std::string&  path() const                  { return m_path; }
+  size_t              size() const                  { return m_commands.size(); }
+
+  // True if the commands were read from the cache.
+  bool                is_cached() const             { return m_cached; }
+
+  // Returns false if the file could not be opened, and throws
+  // input_error with the file name and line on bad input.
+  bool                load(const std::string& path, const std::string& cachePath = std::string());
+
+  void                call(target_type target);
+
+private:
+  void                compile(const char* first, const char* last);
+
+  bool                read_cache(const std::string& cachePath);
+  bool                write_cache(const std::string& cachePath) const;
+
+  void                throw_error(uint32_t line, const char* msg) const;
+
+  std::string         m_path;
+
+  int64_t             m_size;
+  int64_t             m_mtime;
+  uint32_t            m_hash;
+  bool                m_cached;
+
+  command_list        m_commands;
+};
+
+}
+
+#endif
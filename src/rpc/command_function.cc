@@ -48,65 +48,19 @@ namespace rpc {
 
 const torrent::Object
 CommandFunction::call(Command* rawCommand, target_type target, const torrent::Object& args) {
-  char* buffer[sizeof(torrent::Object) * Command::max_arguments];
-  torrent::Object* stack = (torrent::Object*)buffer;
-  torrent::Object* first = (torrent::Object*)buffer;
-
-  if (args.is_list()) {
-    // Do nothing for now.
-    for (torrent::Object::list_const_iterator itr = args.as_list().begin(), last = args.as_list().end();
-         itr != last && first != stack + Command::max_arguments;
-         itr++, first++) {
-      new (first) torrent::Object(*itr);
-      first->swap(*argument(std::distance(stack, first)));
-    }
-
-  } else if (args.type() != torrent::Object::TYPE_NONE) {
-    new (first) torrent::Object(args);
-    (first++)->swap(*argument(0));
-  }
-
   CommandFunction* command = reinterpret_cast<CommandFunction*>(rawCommand);
+  ArgumentFrame frame(args);
 
-  torrent::Object result = parse_command_multiple(target, command->m_command.c_str(), command->m_command.c_str() + command->m_command.size());
-
-  while (first-- != stack) {
-    first->swap(*argument(std::distance(stack, first)));
-    first->~Object();
-  }
-
-  return result;
+  return command->m_command.call(target);
 }
 
 const torrent::Object
 CommandFunctionList::call(Command* rawCommand, target_type target, const torrent::Object& args) {
-  char* buffer[sizeof(torrent::Object) * Command::max_arguments];
-  torrent::Object* stack = (torrent::Object*)buffer;
-  torrent::Object* first = (torrent::Object*)buffer;
-
-  if (args.is_list()) {
-    // Do nothing for now.
-    for (torrent::Object::list_const_iterator itr = args.as_list().begin(), last = args.as_list().end();
-         itr != last && first != stack + Command::max_arguments;
-         itr++, first++) {
-      new (first) torrent::Object(*itr);
-      first->swap(*argument(std::distance(stack, first)));
-    }
-
-  } else if (args.type() != torrent::Object::TYPE_NONE) {
-    new (first) torrent::Object(args);
-    (first++)->swap(*argument(0));
-  }
-
   CommandFunctionList* command = reinterpret_cast<CommandFunctionList*>(rawCommand);
+  ArgumentFrame frame(args);
 
-  for (base_type::const_iterator itr = command->begin(), last = command->end(); itr != last; itr++)
-    parse_command_multiple(target, itr->second.c_str(), itr->second.c_str() + itr->second.size());
-
-  while (first-- != stack) {
-    first->swap(*argument(std::distance(stack, first)));
-    first->~Object();
-  }
+  for (base_type::iterator itr = command->begin(), last = command->end(); itr != last; itr++)
+    itr->second.call(target);
 
   return torrent::Object();
 }
@@ -126,9 +80,9 @@ CommandFunctionList::insert(const std::string& key, const std::string& cmd) {
   base_type::iterator itr = std::find_if(begin(), end(), rak::less_equal(key, rak::mem_ref(&base_type::value_type::first)));
 
   if (itr != end() && itr->first == key)
-    itr->second = cmd;
+    itr->second.set_command(cmd);
   else
-    base_type::insert(itr, base_type::value_type(key, cmd));
+    base_type::insert(itr, base_type::value_type(key, CommandCompiled(cmd)));
 }
 
 void
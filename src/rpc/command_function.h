@@ -44,6 +44,7 @@
 #include <torrent/object.h>
 
 #include "command.h"
+#include "command_compiled.h"
 
 namespace rpc {
 
@@ -51,20 +52,19 @@ class CommandFunction : public Command {
 public:
   CommandFunction(const std::string& cmd = std::string()) : m_command(cmd) {}
   
-  const std::string&  command() const                     { return m_command; }
-  void                set_command(const std::string& cmd) { m_command = cmd; }
+  const std::string&  command() const                     { return m_command.command(); }
+  void                set_command(const std::string& cmd) { m_command.set_command(cmd); }
 
   static const torrent::Object call(Command* rawCommand, target_type target, const torrent::Object& args);
 
 private:
-  // TODO: Replace with a delete-me flag and const char*.
-  std::string         m_command;
+  CommandCompiled     m_command;
 };
 
 class CommandFunctionList : public Command,
-                            private std::vector<std::pair<std::string, std::string> > {
+                            private std::vector<std::pair<std::string, CommandCompiled> > {
 public:
-  typedef std::vector<std::pair<std::string, std::string> > base_type;
+  typedef std::vector<std::pair<std::string, CommandCompiled> > base_type;
 
   using Command::value_type;
   using base_type::iterator;
@@ -36,7 +36,9 @@
 
 #include "config.h"
 
+#include <iterator>
 #include <vector>
+#include <pthread.h>
 #include <torrent/exceptions.h>
 #include <torrent/object.h>
 #include <torrent/data/file_list_iterator.h>
@@ -55,7 +57,46 @@
 
 namespace rpc {
 
-torrent::Object Command::m_arguments[Command::max_arguments];
+ArgumentFrame* ArgumentFrame::m_current = NULL;
+
+// Static initialization runs on the main thread.
+static const pthread_t argument_frame_thread = pthread_self();
+
+void
+ArgumentFrame::check_thread() {
+  if (!pthread_equal(pthread_self(), argument_frame_thread))
+    throw torrent::internal_error("ArgumentFrame used outside the main thread.");
+}
+
+ArgumentFrame::ArgumentFrame(const torrent::Object& args) :
+  m_args(&args),
+  m_parent(m_current) {
+
+  check_thread();
+  m_current = this;
+}
+
+const torrent::Object*
+ArgumentFrame::find(unsigned int index) {
+  check_thread();
+
+  for (ArgumentFrame* frame = m_current; frame != NULL; frame = frame->m_parent) {
+    if (frame->m_args->is_list()) {
+      const torrent::Object::list_type& args = frame->m_args->as_list();
+
+      if (index < args.size()) {
+        torrent::Object::list_const_iterator itr = args.begin();
+        std::advance(itr, index);
+        return &*itr;
+      }
+
+    } else if (index == 0 && frame->m_args->type() != torrent::Object::TYPE_NONE) {
+      return frame->m_args;
+    }
+  }
+
+  return NULL;
+}
 
 CommandMap::~CommandMap() {
   std::vector<const char*> keys;
@@ -79,7 +120,7 @@ CommandMap::insert(key_type key, Command* variable, int flags, const char* parm,
   if (itr != base_type::end())
     throw torrent::internal_error("CommandMap::insert(...) tried to insert an already existing key.");
 
-  if (rpc::xmlrpc.is_valid())
+  if (rpc::xmlrpc.is_registered() && (flags & flag_public_xmlrpc))
     rpc::xmlrpc.insert_command(key, parm, doc);
 
   return base_type::insert(itr, value_type(key, command_map_data_type(variable, flags, parm, doc)));
@@ -111,6 +152,18 @@ CommandMap::erase(iterator itr) {
 
   base_type::erase(itr);
   delete [] key;
+
+  m_generation++;
+}
+
+void
+CommandMap::set_read_only(key_type key) {
+  iterator itr = base_type::find(key);
+
+  if (itr == base_type::end())
+    throw torrent::internal_error("CommandMap::set_read_only(...) key not found.");
+
+  itr->second.m_flags |= flag_read_only;
 }
 
 const CommandMap::mapped_type
@@ -130,6 +183,11 @@ CommandMap::call_command(key_type key, const mapped_type& arg, target_type targe
   if (itr == base_type::end())
     throw torrent::input_error("Command \"" + std::string(key) + "\" does not exist.");
 
+  return call_command(itr, arg, target);
+}
+
+const CommandMap::mapped_type
+CommandMap::call_command(const_iterator itr, const mapped_type& arg, target_type target) {
   if (target.first != Command::target_generic && target.second == NULL) {
     // We received a target that is NULL, so throw an exception unless
     // we can convert it to a void target.
@@ -139,6 +197,9 @@ CommandMap::call_command(key_type key, const mapped_type& arg, target_type targe
     target.first = Command::target_generic;
   }
 
+  if (!(itr->second.m_flags & flag_read_only))
+    m_mutated = true;
+
   if (itr->second.m_target != target.first && itr->second.m_target > Command::target_any) {
     // Mismatch between the target and command type. If it is not
     // possible to convert, then throw an input error.
@@ -167,35 +228,4 @@ CommandMap::call_command(key_type key, const mapped_type& arg, target_type targe
   }
 }
 
-const CommandMap::mapped_type
-CommandMap::call_command(const_iterator itr, const mapped_type& arg, target_type target) {
-  if (target.first != Command::target_generic && target.second == NULL) {
-    // We received a target that is NULL, so throw an exception unless
-    // we can convert it to a void target.
-    if (itr->second.m_target > Command::target_any)
-      throw torrent::input_error("Command type mis-match.");
-
-    target.first = Command::target_generic;
-  }
-
-  if (itr->second.m_target != target.first && itr->second.m_target > Command::target_any)
-    throw torrent::input_error("Command type mis-match.");
-
-  // This _should_ be optimized int just two calls.
-  switch (itr->second.m_target) {
-  case Command::target_any:      return itr->second.m_anySlot(itr->second.m_variable, target, arg);
-
-  case Command::target_generic:
-  case Command::target_download:
-  case Command::target_peer:
-  case Command::target_tracker:
-  case Command::target_file:
-  case Command::target_file_itr: return itr->second.m_genericSlot(itr->second.m_variable, (target_wrapper<void>::cleaned_type)target.second, arg);
-
-  case Command::target_download_pair: return itr->second.m_downloadPairSlot(itr->second.m_variable, (core::Download*)target.second, (core::Download*)target.third, arg);
-
-  default: throw torrent::internal_error("CommandMap::call_command(...) Invalid target.");
-  }
-}
-
 }
@@ -40,6 +40,7 @@
 #include <map>
 #include <string>
 #include <cstring>
+#include <inttypes.h>
 #include <torrent/object.h>
 
 #include "command.h"
@@ -104,14 +105,27 @@ public:
   static const int flag_public_xmlrpc = 0x4;
   static const int flag_no_target     = 0x8;
   static const int flag_modifiable    = 0x10;
+  static const int flag_read_only     = 0x20;
 
-  CommandMap() {}
+  CommandMap() : m_mutated(false), m_generation(0) {}
   ~CommandMap();
 
   bool                has(const char* key) const        { return base_type::find(key) != base_type::end(); }
   bool                has(const std::string& key) const { return has(key.c_str()); }
 
   bool                is_modifiable(const_iterator itr) { return itr != end() && (itr->second.m_flags & flag_modifiable); }
+  bool                is_read_only(const_iterator itr)  { return itr != end() && (itr->second.m_flags & flag_read_only); }
+
+  // Set whenever a command without 'flag_read_only' is called, used
+  // to tell if an RPC request may have changed anything.
+  bool                is_mutated() const                { return m_mutated; }
+  void                set_mutated(bool v)               { m_mutated = v; }
+
+  // Incremented whenever a command is erased, so that holders of
+  // cached iterators know to look the key up again.
+  uint32_t            generation() const                { return m_generation; }
+
+  void                set_read_only(key_type key);
 
   iterator            insert(key_type key, Command* variable, int flags, const char* parm, const char* doc);
 
@@ -142,6 +156,9 @@ public:
 private:
   CommandMap(const CommandMap&);
   void operator = (const CommandMap&);
+
+  bool                m_mutated;
+  uint32_t            m_generation;
 };
 
 inline target_type make_target()                                  { return target_type((int)Command::target_generic, NULL); }
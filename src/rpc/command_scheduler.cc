@@ -42,6 +42,7 @@
 #include <rak/functional.h>
 #include <rak/string_manip.h>
 #include <torrent/exceptions.h>
+#include <torrent/object.h>
 
 #include "command_scheduler.h"
 #include "command_scheduler_item.h"
@@ -72,6 +73,7 @@ CommandScheduler::insert(const std::string& key) {
 
   *itr = new CommandSchedulerItem(key);
   (*itr)->set_slot(rak::bind_mem_fn(this, &CommandScheduler::call_item, *itr));
+  (*itr)->set_index(itr - begin());
 
   return itr;
 }
@@ -82,7 +84,26 @@ CommandScheduler::erase(iterator itr) {
     return;
 
   delete *itr;
-  base_type::erase(itr);
+  itr = base_type::erase(itr);
+
+  for ( ; itr != end(); itr++)
+    (*itr)->set_index(itr - begin());
+}
+
+void
+CommandScheduler::set_jitter(int64_t v) {
+  if (v < 0 || v > (1 << 20))
+    throw torrent::input_error("Invalid jitter.");
+
+  m_jitter = v;
+}
+
+void
+CommandScheduler::set_tick_budget(int64_t v) {
+  if (v < 0 || v > (1 << 20))
+    throw torrent::input_error("Invalid tick budget.");
+
+  m_tickBudget = v * 1000;
 }
 
 void
@@ -90,20 +111,41 @@ CommandScheduler::call_item(value_type item) {
   if (item->is_queued())
     throw torrent::internal_error("CommandScheduler::call_item(...) called but item is still queued.");
 
-  if (std::find(begin(), end(), item) == end())
+  if (item->index() >= size() || base_type::operator[](item->index()) != item)
     throw torrent::internal_error("CommandScheduler::call_item(...) called but the item isn't in the scheduler.");
 
+  // Items due in the same pass of the main loop share the budget,
+  // 'cachedTime' only changes between passes.
+  if (m_tickTime != cachedTime) {
+    m_tickTime = cachedTime;
+    m_tickUsec = 0;
+  }
+
+  if (m_tickBudget != 0 && m_tickUsec >= m_tickBudget) {
+    item->delay(cachedTime + rak::timer(1));
+    item->record_deferred();
+    m_deferred++;
+    return;
+  }
+
   // Remove the item before calling the command if it should be
   // removed.
 
+  rak::timer start = rak::timer::current();
+
   try {
-    rpc::parse_command_multiple_std(item->command());
+    item->call_command();
 
   } catch (torrent::input_error& e) {
     if (m_slotErrorMessage.is_valid())
       m_slotErrorMessage("Scheduled command failed: " + item->key() + ": " + e.what());
   }
 
+  int64_t usec = (rak::timer::current() - start).usec();
+
+  item->record_call(usec);
+  m_tickUsec += usec;
+
   // Still schedule if we caught a torrrent::input_error?
   rak::timer next = item->next_time_scheduled();
 
@@ -135,8 +177,58 @@ CommandScheduler::parse(const std::string& key, const std::string& bufAbsolute,
 
   item->set_command(command);
   item->set_interval(interval);
+  item->set_jitter(m_jitter);
+
+  item->enable((cachedTime + rak::timer::from_seconds(absolute)).round_seconds() + jitter_offset(item->jitter()));
+}
+
+void
+CommandScheduler::set_item_jitter(const std::string& key, uint32_t jitter) {
+  iterator itr = find(key);
+
+  if (itr == end())
+    throw torrent::input_error("Could not find scheduled item.");
+
+  if (jitter > (1 << 20))
+    throw torrent::input_error("Invalid jitter.");
+
+  (*itr)->set_jitter(jitter);
+
+  if ((*itr)->is_queued())
+    (*itr)->enable((*itr)->time_scheduled().round_seconds() + jitter_offset(jitter));
+}
+
+torrent::Object
+CommandScheduler::status() const {
+  torrent::Object result = torrent::Object::create_map();
+
+  for (const_iterator itr = begin(), last = end(); itr != last; itr++) {
+    torrent::Object& entry = result.insert_key((*itr)->key(), torrent::Object::create_map());
+
+    entry.insert_key("interval",  (int64_t)(*itr)->interval());
+    entry.insert_key("jitter",    (int64_t)(*itr)->jitter());
+    entry.insert_key("next",      (*itr)->time_scheduled().seconds());
+    entry.insert_key("calls",     (int64_t)(*itr)->calls());
+    entry.insert_key("deferred",  (int64_t)(*itr)->deferred());
+    entry.insert_key("usec",      (*itr)->usec_total());
+    entry.insert_key("max_usec",  (*itr)->usec_max());
+    entry.insert_key("last_usec", (*itr)->usec_last());
+  }
+
+  return result;
+}
+
+// Random offset below 'jitter' seconds, in microseconds so that items
+// sharing an interval don't end up in the same pass of the main loop.
+rak::timer
+CommandScheduler::jitter_offset(uint32_t jitter) {
+  if (jitter == 0)
+    return rak::timer();
+
+  uint64_t range = (uint64_t)jitter * 1000000;
+  uint64_t value = ((uint64_t)::random() << 31) | (uint64_t)::random();
 
-  item->enable((cachedTime + rak::timer::from_seconds(absolute)).round_seconds());
+  return rak::timer(value % range);
 }
 
 uint32_t
@@ -41,6 +41,11 @@
 #include <string>
 #include <inttypes.h>
 #include <rak/functional_fun.h>
+#include <rak/timer.h>
+
+namespace torrent {
+  class Object;
+}
 
 namespace rpc {
 
@@ -56,11 +61,24 @@ public:
   using base_type::begin;
   using base_type::end;
 
-  CommandScheduler() {}
+  CommandScheduler() : m_jitter(0), m_tickBudget(0), m_tickUsec(0), m_deferred(0) {}
   ~CommandScheduler();
 
   void                set_slot_error_message(SlotString::base_type* s) { m_slotErrorMessage.set(s); }
 
+  // Default jitter in seconds for new items, see
+  // CommandSchedulerItem::jitter().
+  int64_t             jitter() const                                   { return m_jitter; }
+  void                set_jitter(int64_t v);
+
+  // Once the items called during one pass of the main loop have run
+  // for this many milliseconds, the remaining due items are delayed
+  // to the next pass. Zero disables the limit.
+  int64_t             tick_budget() const                              { return m_tickBudget / 1000; }
+  void                set_tick_budget(int64_t v);
+
+  uint64_t            deferred() const                                 { return m_deferred; }
+
   // slot_error_message or something.
 
   iterator            find(const std::string& key);
@@ -73,6 +91,14 @@ public:
 
   void                parse(const std::string& key, const std::string& bufAbsolute, const std::string& bufInterval, const std::string& command);
 
+  // Sets the jitter of an existing item and moves its next call by a
+  // new random offset.
+  void                set_item_jitter(const std::string& key, uint32_t jitter);
+
+  // Map of item names to their interval, jitter, next call and
+  // statistics of the time spent in each call.
+  torrent::Object     status() const;
+
   static uint32_t     parse_absolute(const char* str);
   static uint32_t     parse_interval(const char* str);
 
@@ -81,7 +107,16 @@ public:
 private:
   void                call_item(value_type item);
 
+  static rak::timer   jitter_offset(uint32_t jitter);
+
   SlotString          m_slotErrorMessage;
+
+  int64_t             m_jitter;
+  int64_t             m_tickBudget;
+
+  rak::timer          m_tickTime;
+  int64_t             m_tickUsec;
+  uint64_t            m_deferred;
 };
 
 }
@@ -36,6 +36,7 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <torrent/exceptions.h>
 
 #include "command_scheduler_item.h"
@@ -61,6 +62,20 @@ CommandSchedulerItem::enable(rak::timer t) {
   priority_queue_insert(&taskScheduler, &m_task, t);
 }
 
+void
+CommandSchedulerItem::delay(rak::timer t) {
+  priority_queue_erase(&taskScheduler, &m_task);
+  priority_queue_insert(&taskScheduler, &m_task, t);
+}
+
+void
+CommandSchedulerItem::record_call(int64_t usec) {
+  m_calls++;
+  m_usecTotal += usec;
+  m_usecMax = std::max(m_usecMax, usec);
+  m_usecLast = usec;
+}
+
 void
 CommandSchedulerItem::disable() {
   m_timeScheduled = rak::timer();
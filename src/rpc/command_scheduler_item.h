@@ -38,6 +38,7 @@
 #define RTORRENT_COMMAND_SCHEDULER_ITEM_H
 
 #include "globals.h"
+#include "command_compiled.h"
 
 namespace rpc {
 
@@ -45,7 +46,9 @@ class CommandSchedulerItem {
 public:
   typedef rak::function0<void> Slot;
 
-  CommandSchedulerItem(const std::string& key) : m_key(key), m_interval(0) {}
+  CommandSchedulerItem(const std::string& key) :
+    m_key(key), m_index(0), m_interval(0), m_jitter(0),
+    m_calls(0), m_deferred(0), m_usecTotal(0), m_usecMax(0), m_usecLast(0) { m_task.set_name(m_key.c_str()); }
   ~CommandSchedulerItem();
 
   bool                is_queued() const                       { return m_task.is_queued(); }
@@ -53,30 +56,62 @@ public:
   void                enable(rak::timer t);
   void                disable();
 
+  // Queue the task again without changing the time it was scheduled
+  // for, so later calls keep their phase.
+  void                delay(rak::timer t);
+
   const std::string&  key() const                             { return m_key; }
 
-  const std::string&  command() const                         { return m_command; }
-  void                set_command(const std::string& s)       { m_command = s; }
+  // Position in the CommandScheduler, maintained by it.
+  size_t              index() const                           { return m_index; }
+  void                set_index(size_t i)                     { m_index = i; }
+
+  const std::string&  command() const                         { return m_command.command(); }
+  void                set_command(const std::string& s)       { m_command.set_command(s); }
+
+  torrent::Object     call_command()                          { return m_command.call(make_target()); }
 
   // 'interval()' should in the future return some more dynamic values.
   uint32_t            interval() const                        { return m_interval; }
   void                set_interval(uint32_t v)                { m_interval = v; }
 
+  // Upper bound in seconds of the random offset added to the first
+  // scheduled time.
+  uint32_t            jitter() const                          { return m_jitter; }
+  void                set_jitter(uint32_t v)                  { m_jitter = v; }
+
   rak::timer          time_scheduled() const                  { return m_timeScheduled; }
   rak::timer          next_time_scheduled() const;
 
   void                set_slot(Slot::base_type* s)            { m_task.set_slot(s); }
 
+  uint64_t            calls() const                           { return m_calls; }
+  uint64_t            deferred() const                        { return m_deferred; }
+  int64_t             usec_total() const                      { return m_usecTotal; }
+  int64_t             usec_max() const                        { return m_usecMax; }
+  int64_t             usec_last() const                       { return m_usecLast; }
+
+  void                record_call(int64_t usec);
+  void                record_deferred()                       { m_deferred++; }
+
 private:
   CommandSchedulerItem(const CommandSchedulerItem&);
   void operator = (const CommandSchedulerItem&);
 
   std::string         m_key;
-  std::string         m_command;
+  CommandCompiled     m_command;
+  size_t              m_index;
   
   uint32_t            m_interval;
+  uint32_t            m_jitter;
   rak::timer          m_timeScheduled;
 
+  uint64_t            m_calls;
+  uint64_t            m_deferred;
+  int64_t             m_usecTotal;
+  int64_t             m_usecMax;
+  int64_t             m_usecLast;
+
   rak::priority_item  m_task;
 
   // Flags for various things.
@@ -0,0 +1,248 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <rak/error_number.h>
+#include <rak/socket_address.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <torrent/connection_manager.h>
+#include <torrent/exceptions.h>
+#include <torrent/poll.h>
+
+#include "utils/socket_fd.h"
+
+#include "control.h"
+#include "globals.h"
+#include "event_stream.h"
+
+namespace rpc {
+
+void
+EventStreamClient::open(int fd) {
+  m_fileDesc = fd;
+  m_position = 0;
+
+  if (!get_fd().set_nonblock()) {
+    get_fd().close();
+    get_fd().clear();
+    return;
+  }
+
+  // Subscribers don't send anything, but reading lets us notice
+  // when they disconnect.
+  this_thread->poll()->open(this);
+  this_thread->poll()->insert_read(this);
+  this_thread->poll()->insert_error(this);
+}
+
+void
+EventStreamClient::close() {
+  if (!get_fd().is_valid())
+    return;
+
+  this_thread->poll()->remove_read(this);
+  this_thread->poll()->remove_write(this);
+  this_thread->poll()->remove_error(this);
+  this_thread->poll()->close(this);
+
+  get_fd().close();
+  get_fd().clear();
+
+  m_queue.clear();
+  m_position = 0;
+}
+
+void
+EventStreamClient::push(const std::string& line) {
+  if (!is_open())
+    return;
+
+  if (m_queue.empty())
+    this_thread->poll()->insert_write(this);
+
+  // Skip the line currently being written, it can't be coalesced. An
+  // identical pending line is moved to the back so that the client
+  // sees events in the order of their latest occurrence.
+  queue_type::iterator itr = std::find(m_queue.begin() + (m_position != 0), m_queue.end(), line);
+
+  if (itr != m_queue.end())
+    m_queue.erase(itr);
+
+  if (m_queue.size() >= max_queue_size) {
+    m_queue.erase(m_queue.begin() + (m_position != 0), m_queue.end());
+    m_queue.push_back("overflow\n");
+    return;
+  }
+
+  m_queue.push_back(line);
+}
+
+void
+EventStreamClient::event_read() {
+  char buffer[256];
+  int bytes = ::recv(m_fileDesc, buffer, sizeof(buffer), 0);
+
+  if (bytes == 0 || (bytes < 0 && !rak::error_number::current().is_blocked_momentary()))
+    close();
+}
+
+void
+EventStreamClient::event_write() {
+  while (!m_queue.empty()) {
+    const std::string& line = m_queue.front();
+    int bytes = ::send(m_fileDesc, line.c_str() + m_position, line.size() - m_position, 0);
+
+    if (bytes == -1) {
+      if (!rak::error_number::current().is_blocked_momentary())
+        close();
+
+      return;
+    }
+
+    if ((m_position += bytes) != line.size())
+      return;
+
+    m_queue.pop_front();
+    m_position = 0;
+  }
+
+  this_thread->poll()->remove_write(this);
+}
+
+void
+EventStreamClient::event_error() {
+  close();
+}
+
+EventStream::~EventStream() {
+  if (!get_fd().is_valid())
+    return;
+
+  for (EventStreamClient* itr = m_clients, *last = m_clients + max_clients; itr != last; ++itr)
+    itr->close();
+
+  this_thread->poll()->remove_read(this);
+  this_thread->poll()->remove_error(this);
+  this_thread->poll()->close(this);
+
+  torrent::connection_manager()->dec_socket_count();
+
+  get_fd().close();
+  get_fd().clear();
+
+  if (!m_path.empty())
+    ::unlink(m_path.c_str());
+}
+
+void
+EventStream::open_named(const std::string& filename) {
+  sockaddr_un sa;
+
+  if (filename.empty() || filename.size() >= sizeof(sa.sun_path))
+    throw torrent::input_error("Invalid filename length.");
+
+  std::memset(&sa, 0, sizeof(sockaddr_un));
+  sa.sun_family = AF_LOCAL;
+  std::memcpy(sa.sun_path, filename.c_str(), filename.size() + 1);
+
+  if (!get_fd().open_local())
+    throw torrent::input_error("Could not open event stream socket.");
+
+  if (!get_fd().set_nonblock() ||
+      !get_fd().set_reuse_address(true) ||
+      !get_fd().bind(*reinterpret_cast<rak::socket_address*>(&sa), offsetof(struct sockaddr_un, sun_path) + filename.size() + 1) ||
+      !get_fd().listen(max_clients)) {
+    get_fd().close();
+    get_fd().clear();
+
+    throw torrent::input_error("Could not prepare event stream socket: " + std::string(rak::error_number::current().c_str()));
+  }
+
+  torrent::connection_manager()->inc_socket_count();
+  m_path = filename;
+
+  this_thread->poll()->open(this);
+  this_thread->poll()->insert_read(this);
+  this_thread->poll()->insert_error(this);
+}
+
+unsigned int
+EventStream::size() const {
+  return std::count_if(m_clients, m_clients + max_clients, std::mem_fun_ref(&EventStreamClient::is_open));
+}
+
+void
+EventStream::push(const std::string& line) {
+  std::string terminated = line + '\n';
+
+  for (EventStreamClient* itr = m_clients, *last = m_clients + max_clients; itr != last; ++itr)
+    itr->push(terminated);
+}
+
+void
+EventStream::event_read() {
+  rak::socket_address sa;
+  utils::SocketFd fd;
+
+  while ((fd = get_fd().accept(&sa)).is_valid()) {
+    EventStreamClient* client = std::find_if(m_clients, m_clients + max_clients, std::mem_fun_ref(&EventStreamClient::is_available));
+
+    if (client == m_clients + max_clients) {
+      fd.close();
+      continue;
+    }
+
+    client->open(fd.get_fd());
+  }
+}
+
+void
+EventStream::event_write() {
+  throw torrent::internal_error("Listener does not support write().");
+}
+
+void
+EventStream::event_error() {
+  throw torrent::internal_error("Event stream listener received an error event.");
+}
+
+}
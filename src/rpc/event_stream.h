@@ -0,0 +1,111 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_EVENT_STREAM_H
+#define RTORRENT_RPC_EVENT_STREAM_H
+
+#include <deque>
+#include <string>
+#include <torrent/event.h>
+
+namespace utils {
+  class SocketFd;
+}
+
+namespace rpc {
+
+// A subscriber connected to the event stream. Pending lines are kept
+// in a bounded queue, identical lines that have not been sent yet
+// are coalesced into the newest one, and if the client falls too far
+// behind the queue is replaced by a single "overflow" line telling it
+// to resynchronize.
+
+class EventStreamClient : public torrent::Event {
+public:
+  typedef std::deque<std::string> queue_type;
+
+  static const unsigned int max_queue_size = 256;
+
+  EventStreamClient() : m_position(0) { m_fileDesc = -1; }
+
+  bool                is_open() const      { return m_fileDesc != -1; }
+  bool                is_available() const { return m_fileDesc == -1; }
+
+  void                open(int fd);
+  void                close();
+
+  void                push(const std::string& line);
+
+  virtual void        event_read();
+  virtual void        event_write();
+  virtual void        event_error();
+
+  utils::SocketFd&    get_fd()            { return *reinterpret_cast<utils::SocketFd*>(&m_fileDesc); }
+
+private:
+  queue_type          m_queue;
+  unsigned int        m_position;
+};
+
+class EventStream : public torrent::Event {
+public:
+  static const int max_clients = 16;
+
+  EventStream() { m_fileDesc = -1; }
+  virtual ~EventStream();
+
+  void                open_named(const std::string& filename);
+
+  const std::string&  path() const        { return m_path; }
+  unsigned int        size() const;
+
+  // Queue a line, without the trailing newline, for all subscribers.
+  void                push(const std::string& line);
+
+  virtual void        event_read();
+  virtual void        event_write();
+  virtual void        event_error();
+
+  utils::SocketFd&    get_fd()            { return *reinterpret_cast<utils::SocketFd*>(&m_fileDesc); }
+
+private:
+  std::string         m_path;
+  EventStreamClient   m_clients[max_clients];
+};
+
+}
+
+#endif
@@ -0,0 +1,572 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <torrent/exceptions.h>
+
+#include "parse.h"
+#include "parse_commands.h"
+#include "expression.h"
+
+namespace rpc {
+
+static const char*
+expression_skip_space(const char* first, const char* last) {
+  while (first != last && (*first == ' ' || *first == '\t' || *first == '\n'))
+    first++;
+
+  return first;
+}
+
+// Consumes 'token' if it is next in the input, but not when it is
+// only the start of a longer operator such as '<' in '<='.
+static bool
+expression_consume(const char** first, const char* last, const char* token) {
+  const char* itr = expression_skip_space(*first, last);
+  size_t length = std::strlen(token);
+
+  if ((size_t)(last - itr) < length || std::strncmp(itr, token, length) != 0)
+    return false;
+
+  if (length == 1 && itr + 1 != last && itr[1] == '=' &&
+      (*token == '<' || *token == '>' || *token == '!' || *token == '='))
+    return false;
+
+  if (length == 1 && itr + 1 != last && itr[1] == *token && (*token == '&' || *token == '|'))
+    return false;
+
+  *first = itr + length;
+  return true;
+}
+
+static bool
+expression_is_name(char c) {
+  return std::isalnum((unsigned char)c) || c == '_' || c == '.';
+}
+
+void
+Expression::compile(const char* first, const char* last) {
+  node_list nodes;
+  m_nodes.swap(nodes);
+  m_nesting = 0;
+
+  try {
+    m_root = parse_or(&first, last);
+
+    if (expression_skip_space(first, last) != last)
+      throw torrent::input_error("Junk at end of expression.");
+
+  } catch (torrent::input_error&) {
+    clear();
+    throw;
+  }
+}
+
+uint32_t
+Expression::push_node(int type, uint32_t left, uint32_t right) {
+  m_nodes.push_back(node());
+
+  node& n = m_nodes.back();
+  n.m_type = type;
+  n.m_left = left;
+  n.m_right = right;
+  n.m_depth = 1;
+  n.m_value = 0;
+  n.m_itr = commands.end();
+  n.m_generation = commands.generation();
+
+  uint32_t index = m_nodes.size() - 1;
+
+  if (type >= node::type_not)
+    update_depth(index, left);
+
+  if (type >= node::type_and)
+    update_depth(index, right);
+
+  return index;
+}
+
+void
+Expression::update_depth(uint32_t index, uint32_t child) {
+  m_nodes[index].m_depth = std::max(m_nodes[index].m_depth, m_nodes[child].m_depth + 1);
+
+  if (m_nodes[index].m_depth > max_depth)
+    throw torrent::input_error("Expression is too deeply nested.");
+}
+
+uint32_t
+Expression::parse_or(const char** first, const char* last) {
+  uint32_t left = parse_and(first, last);
+
+  while (expression_consume(first, last, "||"))
+    left = push_node(node::type_or, left, parse_and(first, last));
+
+  return left;
+}
+
+uint32_t
+Expression::parse_and(const char** first, const char* last) {
+  uint32_t left = parse_compare(first, last);
+
+  while (expression_consume(first, last, "&&"))
+    left = push_node(node::type_and, left, parse_compare(first, last));
+
+  return left;
+}
+
+uint32_t
+Expression::parse_compare(const char** first, const char* last) {
+  uint32_t left = parse_add(first, last);
+
+  if (expression_consume(first, last, "=="))
+    return push_node(node::type_equal, left, parse_add(first, last));
+  else if (expression_consume(first, last, "!="))
+    return push_node(node::type_not_equal, left, parse_add(first, last));
+  else if (expression_consume(first, last, "<="))
+    return push_node(node::type_less_equal, left, parse_add(first, last));
+  else if (expression_consume(first, last, ">="))
+    return push_node(node::type_greater_equal, left, parse_add(first, last));
+  else if (expression_consume(first, last, "<"))
+    return push_node(node::type_less, left, parse_add(first, last));
+  else if (expression_consume(first, last, ">"))
+    return push_node(node::type_greater, left, parse_add(first, last));
+  else
+    return left;
+}
+
+uint32_t
+Expression::parse_add(const char** first, const char* last) {
+  uint32_t left = parse_mul(first, last);
+
+  while (true) {
+    if (expression_consume(first, last, "+"))
+      left = push_node(node::type_add, left, parse_mul(first, last));
+    else if (expression_consume(first, last, "-"))
+      left = push_node(node::type_subtract, left, parse_mul(first, last));
+    else
+      return left;
+  }
+}
+
+uint32_t
+Expression::parse_mul(const char** first, const char* last) {
+  uint32_t left = parse_unary(first, last);
+
+  while (true) {
+    if (expression_consume(first, last, "*"))
+      left = push_node(node::type_multiply, left, parse_unary(first, last));
+    else if (expression_consume(first, last, "/"))
+      left = push_node(node::type_divide, left, parse_unary(first, last));
+    else if (expression_consume(first, last, "%"))
+      left = push_node(node::type_modulo, left, parse_unary(first, last));
+    else
+      return left;
+  }
+}
+
+// Every level of recursion passes through here, so this is where
+// the nesting is counted. The counter is reset by compile() when an
+// exception unwinds past it.
+uint32_t
+Expression::parse_unary(const char** first, const char* last) {
+  if (++m_nesting > max_nesting)
+    throw torrent::input_error("Expression is too deeply nested.");
+
+  uint32_t index;
+
+  if (expression_consume(first, last, "!"))
+    index = push_node(node::type_not, parse_unary(first, last));
+  else if (expression_consume(first, last, "-"))
+    index = push_node(node::type_negate, parse_unary(first, last));
+  else
+    index = parse_primary(first, last);
+
+  m_nesting--;
+  return index;
+}
+
+uint32_t
+Expression::parse_primary(const char** first, const char* last) {
+  const char* itr = expression_skip_space(*first, last);
+
+  if (itr == last)
+    throw torrent::input_error("Unexpected end of expression.");
+
+  if (*itr == '(') {
+    *first = itr + 1;
+    uint32_t index = parse_or(first, last);
+
+    if (!expression_consume(first, last, ")"))
+      throw torrent::input_error("Missing ')' in expression.");
+
+    return index;
+  }
+
+  if (std::isdigit((unsigned char)*itr)) {
+    int64_t v;
+    *first = parse_value(itr, &v);
+
+    uint32_t index = push_node(node::type_value);
+    m_nodes[index].m_value = v;
+    return index;
+  }
+
+  if (*itr == '\'' || *itr == '"') {
+    char quote = *itr++;
+    std::string str;
+
+    while (itr != last && *itr != quote) {
+      if (*itr == '\\' && ++itr == last)
+        break;
+
+      str.push_back(*itr++);
+    }
+
+    if (itr == last)
+      throw torrent::input_error("Missing closing quote in expression.");
+
+    *first = itr + 1;
+
+    uint32_t index = push_node(node::type_string);
+    m_nodes[index].m_string.swap(str);
+    return index;
+  }
+
+  int type = node::type_call;
+
+  if (last - itr > 5 && std::strncmp(itr, "left:", 5) == 0) {
+    type = node::type_call_left;
+    itr += 5;
+  } else if (last - itr > 6 && std::strncmp(itr, "right:", 6) == 0) {
+    type = node::type_call_right;
+    itr += 6;
+  }
+
+  if (itr == last || !std::isalpha((unsigned char)*itr))
+    throw torrent::input_error("Invalid start of name in expression.");
+
+  const char* nameFirst = itr;
+
+  while (itr != last && expression_is_name(*itr))
+    itr++;
+
+  uint32_t index = push_node(type);
+  m_nodes[index].m_string.assign(nameFirst, itr);
+
+  // Allow the command string style 'd.get_name=', but not 'a==b'.
+  if (itr != last && *itr == '=' && (itr + 1 == last || itr[1] != '='))
+    itr++;
+
+  *first = itr;
+
+  if (expression_consume(first, last, "(") && !expression_consume(first, last, ")")) {
+    do {
+      uint32_t arg = parse_or(first, last);
+      m_nodes[index].m_args.push_back(arg);
+      update_depth(index, arg);
+    } while (expression_consume(first, last, ","));
+
+    if (!expression_consume(first, last, ")"))
+      throw torrent::input_error("Missing ')' in expression.");
+  }
+
+  return index;
+}
+
+torrent::Object
+Expression::evaluate(target_type target) {
+  if (m_nodes.empty())
+    return torrent::Object();
+
+  value result;
+  evaluate_node(m_root, target, &result);
+
+  if (result.m_isString)
+    return *result.m_stringPtr;
+  else
+    return result.m_value;
+}
+
+bool
+Expression::evaluate_bool(target_type target) {
+  if (m_nodes.empty())
+    return true;
+
+  value result;
+  evaluate_node(m_root, target, &result);
+
+  return result.as_bool();
+}
+
+void
+Expression::evaluate_call(node& n, target_type target, value* dest) {
+  if (n.m_itr == commands.end() || n.m_generation != commands.generation()) {
+    n.m_itr = commands.find(n.m_string.c_str());
+    n.m_generation = commands.generation();
+
+    if (n.m_itr == commands.end())
+      throw torrent::input_error("Command \"" + n.m_string + "\" does not exist.");
+  }
+
+  torrent::Object args;
+
+  if (!n.m_args.empty()) {
+    args = torrent::Object::create_list();
+
+    for (std::vector<uint32_t>::const_iterator itr = n.m_args.begin(), last = n.m_args.end(); itr != last; itr++) {
+      value arg;
+      evaluate_node(*itr, target, &arg);
+
+      if (arg.m_isString)
+        args.as_list().push_back(*arg.m_stringPtr);
+      else
+        args.as_list().push_back(arg.m_value);
+    }
+
+    if (n.m_args.size() == 1)
+      args = torrent::Object(args.as_list().front());
+  }
+
+  if (n.m_type != node::type_call) {
+    if (!is_target_pair(target))
+      throw torrent::input_error("Expression uses 'left:' or 'right:' without a pair of targets.");
+
+    target = n.m_type == node::type_call_left ? get_target_left(target) : get_target_right(target);
+  }
+
+  torrent::Object result = commands.call_command(n.m_itr, args, target);
+
+  switch (result.type()) {
+  case torrent::Object::TYPE_VALUE:
+    dest->set_value(result.as_value());
+    break;
+  case torrent::Object::TYPE_STRING:
+    dest->m_string.swap(result.as_string());
+    dest->set_string(&dest->m_string);
+    break;
+  case torrent::Object::TYPE_LIST:
+    dest->set_value(!result.as_list().empty());
+    break;
+  case torrent::Object::TYPE_MAP:
+    dest->set_value(!result.as_map().empty());
+    break;
+  default:
+    dest->set_value(0);
+    break;
+  }
+}
+
+void
+Expression::evaluate_node(uint32_t index, target_type target, value* dest) {
+  node& n = m_nodes[index];
+
+  switch (n.m_type) {
+  case node::type_value:
+    dest->set_value(n.m_value);
+    return;
+
+  case node::type_string:
+    dest->set_string(&n.m_string);
+    return;
+
+  case node::type_call:
+  case node::type_call_left:
+  case node::type_call_right:
+    evaluate_call(n, target, dest);
+    return;
+
+  case node::type_not:
+    evaluate_node(n.m_left, target, dest);
+    dest->set_value(!dest->as_bool());
+    return;
+
+  case node::type_and:
+    evaluate_node(n.m_left, target, dest);
+
+    if (dest->as_bool())
+      evaluate_node(n.m_right, target, dest);
+
+    dest->set_value(dest->as_bool());
+    return;
+
+  case node::type_or:
+    evaluate_node(n.m_left, target, dest);
+
+    if (!dest->as_bool())
+      evaluate_node(n.m_right, target, dest);
+
+    dest->set_value(dest->as_bool());
+    return;
+
+  default:
+    break;
+  }
+
+  value right;
+
+  if (n.m_type == node::type_negate) {
+    evaluate_node(n.m_left, target, dest);
+
+    if (dest->m_isString)
+      throw torrent::input_error("Type mismatch.");
+
+    dest->set_value(evaluate_arithmetic(node::type_subtract, 0, dest->m_value));
+    return;
+  }
+
+  evaluate_node(n.m_left, target, dest);
+  evaluate_node(n.m_right, target, &right);
+
+  if (dest->m_isString != right.m_isString)
+    throw torrent::input_error("Type mismatch.");
+
+  if (dest->m_isString) {
+    int cmp = dest->m_stringPtr->compare(*right.m_stringPtr);
+
+    switch (n.m_type) {
+    case node::type_equal:         dest->set_value(cmp == 0); return;
+    case node::type_not_equal:     dest->set_value(cmp != 0); return;
+    case node::type_less:          dest->set_value(cmp < 0); return;
+    case node::type_less_equal:    dest->set_value(cmp <= 0); return;
+    case node::type_greater:       dest->set_value(cmp > 0); return;
+    case node::type_greater_equal: dest->set_value(cmp >= 0); return;
+    default: throw torrent::input_error("Type mismatch.");
+    }
+  }
+
+  int64_t l = dest->m_value;
+  int64_t r = right.m_value;
+
+  switch (n.m_type) {
+  case node::type_equal:         dest->set_value(l == r); return;
+  case node::type_not_equal:     dest->set_value(l != r); return;
+  case node::type_less:          dest->set_value(l < r); return;
+  case node::type_less_equal:    dest->set_value(l <= r); return;
+  case node::type_greater:       dest->set_value(l > r); return;
+  case node::type_greater_equal: dest->set_value(l >= r); return;
+
+  case node::type_add:
+  case node::type_subtract:
+  case node::type_multiply:
+  case node::type_divide:
+  case node::type_modulo:
+    dest->set_value(evaluate_arithmetic(n.m_type, l, r));
+    return;
+
+  default:
+    throw torrent::internal_error("Expression::evaluate_node(...) invalid node type.");
+  }
+}
+
+// Checked integer arithmetic, as expressions come from RPC clients
+// and signed overflow or INT64_MIN / -1 would bring down the client.
+int64_t
+Expression::evaluate_arithmetic(int type, int64_t l, int64_t r) {
+  static const int64_t max_value = std::numeric_limits<int64_t>::max();
+  static const int64_t min_value = std::numeric_limits<int64_t>::min();
+
+  switch (type) {
+  case node::type_add:
+    if ((r > 0 && l > max_value - r) || (r < 0 && l < min_value - r))
+      break;
+
+    return l + r;
+
+  case node::type_subtract:
+    if ((r < 0 && l > max_value + r) || (r > 0 && l < min_value + r))
+      break;
+
+    return l - r;
+
+  case node::type_multiply:
+    if (l == 0 || r == 0)
+      return 0;
+
+    if ((l == -1 && r == min_value) || (r == -1 && l == min_value))
+      break;
+
+    if (l != -1 && r != -1 &&
+        (l > 0 ? (r > 0 ? l > max_value / r : r < min_value / l) : (r > 0 ? l < min_value / r : l < max_value / r)))
+      break;
+
+    return l * r;
+
+  case node::type_divide:
+  case node::type_modulo:
+    if (r == 0)
+      throw torrent::input_error("Division by zero.");
+
+    if (r == -1 && l == min_value)
+      break;
+
+    return type == node::type_divide ? l / r : l % r;
+
+  default:
+    throw torrent::internal_error("Expression::evaluate_arithmetic(...) invalid node type.");
+  }
+
+  throw torrent::input_error("Integer overflow in expression.");
+}
+
+bool
+expression_from_command(const std::string& cmd, Expression* expr) {
+  expr->clear();
+
+  std::string key;
+  torrent::Object args;
+
+  const char* first = cmd.c_str();
+  const char* last = cmd.c_str() + cmd.size();
+
+  try {
+    first = parse_command_split(first, last, &key, &args);
+  } catch (torrent::input_error&) {
+    return false;
+  }
+
+  if (key != "expr" || !args.is_string() || first != last)
+    return false;
+
+  expr->compile(args.as_string());
+  return true;
+}
+
+}
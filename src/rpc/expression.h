@@ -0,0 +1,179 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_EXPRESSION_H
+#define RTORRENT_RPC_EXPRESSION_H
+
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <torrent/object.h>
+
+#include "command_map.h"
+
+namespace rpc {
+
+// Typed expressions for filters, sorting and conditions, compiled
+// once into a flat node array and evaluated without going through
+// torrent::Object except for the command calls themselves.
+//
+//   d.get_complete && d.get_ratio >= 1000 || d.get_name == 'foo'
+//   left:d.get_ratio < right:d.get_ratio
+//
+// Operators are, by increasing precedence: '||', '&&', comparisons
+// ('==', '!=', '<', '<=', '>', '>='), '+' and '-', '*', '/' and '%',
+// and the unary '!' and '-'. Logical operators short-circuit and
+// return 0 or 1. Literals are integers and single or double quoted
+// strings.
+//
+// A name calls the command with no arguments, an optional trailing
+// '=' is accepted for compatibility with command strings. Arguments
+// are passed as 'name(expr, ...)'. The 'left:' and 'right:' prefixes
+// call the command on one side of a download pair, as used by view
+// sorting.
+//
+// Nesting of parentheses, unary operators and calls, and the depth of
+// the compiled tree, are limited so that untrusted input can't
+// exhaust the stack while compiling or evaluating.
+
+class Expression {
+public:
+  static const uint32_t max_nesting = 256;
+  static const uint32_t max_depth   = 4096;
+
+  Expression() : m_root(0), m_nesting(0) {}
+
+  bool                empty() const                       { return m_nodes.empty(); }
+  void                clear()                             { m_nodes.clear(); m_root = 0; }
+
+  // Throws torrent::input_error on syntax errors.
+  void                compile(const char* first, const char* last);
+  void                compile(const std::string& str)     { compile(str.c_str(), str.c_str() + str.size()); }
+
+  torrent::Object     evaluate(target_type target);
+  bool                evaluate_bool(target_type target);
+
+private:
+  struct node;
+  struct value;
+
+  typedef std::vector<node> node_list;
+
+  uint32_t            parse_or(const char** first, const char* last);
+  uint32_t            parse_and(const char** first, const char* last);
+  uint32_t            parse_compare(const char** first, const char* last);
+  uint32_t            parse_add(const char** first, const char* last);
+  uint32_t            parse_mul(const char** first, const char* last);
+  uint32_t            parse_unary(const char** first, const char* last);
+  uint32_t            parse_primary(const char** first, const char* last);
+
+  uint32_t            push_node(int type, uint32_t left = 0, uint32_t right = 0);
+  void                update_depth(uint32_t index, uint32_t child);
+
+  void                evaluate_node(uint32_t index, target_type target, value* dest);
+  void                evaluate_call(node& n, target_type target, value* dest);
+
+  static int64_t      evaluate_arithmetic(int type, int64_t l, int64_t r);
+
+  node_list           m_nodes;
+  uint32_t            m_root;
+  uint32_t            m_nesting;
+};
+
+struct Expression::value {
+  value() : m_isString(false), m_value(0), m_stringPtr(NULL) {}
+
+  bool                as_bool() const                     { return m_isString ? !m_stringPtr->empty() : m_value != 0; }
+
+  void                set_value(int64_t v)                { m_isString = false; m_value = v; }
+  void                set_string(const std::string* s)    { m_isString = true; m_stringPtr = s; }
+
+  bool                m_isString;
+  int64_t             m_value;
+
+  // Points either to a string literal in the node list or to
+  // 'm_string', which holds command results.
+  const std::string*  m_stringPtr;
+  std::string         m_string;
+};
+
+struct Expression::node {
+  enum {
+    type_value,
+    type_string,
+    type_call,
+    type_call_left,
+    type_call_right,
+
+    type_not,
+    type_negate,
+    type_and,
+    type_or,
+
+    type_equal,
+    type_not_equal,
+    type_less,
+    type_less_equal,
+    type_greater,
+    type_greater_equal,
+
+    type_add,
+    type_subtract,
+    type_multiply,
+    type_divide,
+    type_modulo
+  };
+
+  int                        m_type;
+  uint32_t                   m_left;
+  uint32_t                   m_right;
+  uint32_t                   m_depth;
+
+  int64_t                    m_value;
+  std::string                m_string;
+  std::vector<uint32_t>      m_args;
+
+  CommandMap::const_iterator m_itr;
+  uint32_t                   m_generation;
+};
+
+// Compiles 'cmd' into 'expr' if it is a single 'expr=...' command,
+// returning false and clearing 'expr' otherwise.
+bool expression_from_command(const std::string& cmd, Expression* expr);
+
+}
+
+#endif
@@ -171,7 +171,7 @@ parse_value_nothrow(const char* src, int64_t* value, int base, int unit) {
 // Somewhat ugly...
 const char*
 parse_object(const char* first, const char* last, torrent::Object* dest, bool (*delim)(const char)) {
-  if (*first == '{') {
+  if (first != last && *first == '{') {
     *dest = torrent::Object::create_list();
     first = parse_list(first + 1, last, dest, &parse_is_delim_block);
     first = parse_skip_wspace(first, last);
@@ -37,12 +37,11 @@
 #include "config.h"
 
 #include <algorithm>
-#include <fstream>
 #include <string>
 #include <rak/functional.h>
-#include <rak/path.h>
 #include <torrent/exceptions.h>
 
+#include "command_file.h"
 #include "parse.h"
 #include "parse_commands.h"
 
@@ -100,24 +99,20 @@ parse_command_execute(target_type target, torrent::Object* object) {
   }
 }
 
-// Set 'download' to NULL to call the generic functions, thus reusing
-// the code below for both cases.
-parse_command_type
-parse_command(target_type target, const char* first, const char* last) {
+const char*
+parse_command_split(const char* first, const char* last, std::string* key, torrent::Object* args) {
   first = std::find_if(first, last, std::not1(command_map_is_space()));
 
   if (first == last || *first == '#')
-    return std::make_pair(torrent::Object(), first);
+    return first;
   
-  std::string key;
-  first = parse_command_name(first, last, &key);
+  first = parse_command_name(first, last, key);
   first = std::find_if(first, last, std::not1(command_map_is_space()));
   
   if (first == last || *first != '=')
     throw torrent::input_error("Could not find '='.");
 
-  torrent::Object args;
-  first = parse_whole_list(first + 1, last, &args, &parse_is_delim_command);
+  first = parse_whole_list(first + 1, last, args, &parse_is_delim_command);
 
   // Find the last character that is part of this command, skipping
   // the whitespace at the end. This ensures us that the caller
@@ -131,6 +126,21 @@ parse_command(target_type target, const char* first, const char* last) {
     first++;
   }
 
+  return first;
+}
+
+// Set 'download' to NULL to call the generic functions, thus reusing
+// the code below for both cases.
+parse_command_type
+parse_command(target_type target, const char* first, const char* last) {
+  std::string key;
+  torrent::Object args;
+
+  first = parse_command_split(first, last, &key, &args);
+
+  if (key.empty())
+    return std::make_pair(torrent::Object(), first);
+
   // Replace any strings starting with '$' with the result of the
   // following command.
   parse_command_execute(target, &args);
@@ -159,55 +169,13 @@ parse_command_object(target_type target, const torrent::Object& object) {
 }
 
 bool
-parse_command_file(const std::string& path) {
-  std::fstream file(rak::path_expand(path).c_str(), std::ios::in);
+parse_command_file(const std::string& path, const std::string& cachePath) {
+  CommandFile file;
 
-  if (!file.is_open())
+  if (!file.load(path, cachePath))
     return false;
 
-  unsigned int lineNumber = 0;
-  char buffer[4096];
-
-  try {
-    unsigned int getCount = 0;
-
-    while (file.good()
-           && !file.getline(buffer + getCount, 4096 - getCount).fail()) {
-      
-      if (file.gcount() == 0)
-        throw torrent::internal_error("parse_command_file(...) file.gcount() == 0.");
-      int lineLength = file.gcount() - 1;
-      // In case we are at the end of the file and the last character is
-      // not a line feed, we'll just increase the read character count so 
-      // that the last would also be included in option line.
-      if (file.eof() && file.get() != '\n')
-        lineLength++;
-      
-      int escaped = parse_count_escaped(buffer + getCount, buffer + getCount + lineLength);
-
-      lineNumber++;
-      getCount += lineLength;
-
-      if (getCount == 4096 - 1)
-        throw torrent::input_error("Exceeded max line length.");
-      
-      if (escaped & 0x1) {
-        // Remove the escape characters and continue reading.
-        getCount -= escaped;
-        continue;
-      }
-
-      // Would be nice to make this zero-copy.
-      parse_command(make_target(), buffer, buffer + getCount);
-      getCount = 0;
-    }
-
-  } catch (torrent::input_error& e) {
-    snprintf(buffer, 2048, "Error in option file: %s:%u: %s", path.c_str(), lineNumber, e.what());
-
-    throw torrent::input_error(buffer);
-  }
-
+  file.call(make_target());
   return true;
 }
 
@@ -40,6 +40,7 @@
 #include <string>
 #include <cstring>
 
+#include "command_compiled.h"
 #include "command_map.h"
 #include "exec_file.h"
 #include "xmlrpc.h"
@@ -60,6 +61,11 @@ typedef std::pair<torrent::Object, const char*> parse_command_type;
 // The generic parse command function, used by the rest. At some point
 // the 'download' parameter should be replaced by a more generic one.
 parse_command_type     parse_command(target_type target, const char* first, const char* last);
+void                   parse_command_execute(target_type target, torrent::Object* object);
+
+// Splits out the key and arguments of the first command without
+// calling it. The key is left empty on blank input and comments.
+const char*            parse_command_split(const char* first, const char* last, std::string* key, torrent::Object* args);
 torrent::Object        parse_command_multiple(target_type target, const char* first, const char* last);
 
 // Make this take care of lists too.
@@ -68,8 +74,11 @@ parse_command_type     parse_command_object(target_type target, const torrent::O
 inline torrent::Object parse_command_single(target_type target, const char* first)   { return parse_command(target, first, first + std::strlen(first)).first; }
 inline torrent::Object parse_command_multiple(target_type target, const char* first) { return parse_command_multiple(target, first, first + std::strlen(first)); }
 
-bool                   parse_command_file(const std::string& path);
+// Returns false if the file could not be opened. If 'cachePath' is
+// given the parsed commands are cached there, see CommandFile.
+bool                   parse_command_file(const std::string& path, const std::string& cachePath = std::string());
 const char*            parse_command_name(const char* first, const char* last, std::string* dest);
+int                    parse_count_escaped(const char* first, const char* last);
 
 inline torrent::Object
 parse_command_single(target_type target, const std::string& cmd) {
@@ -91,6 +100,15 @@ parse_command_multiple_d_nothrow(core::Download* download, const std::string& cm
   }
 }
 
+inline torrent::Object
+call_compiled_d_nothrow(core::Download* download, CommandCompiled* cmd) {
+  try {
+    return cmd->call(make_target(download));
+  } catch (torrent::input_error& e) {
+    return torrent::Object();
+  }
+}
+
 inline void
 parse_command_d_single_std(core::Download* download, const std::string& cmd) {
   parse_command(make_target(download), cmd.c_str(), cmd.c_str() + cmd.size());
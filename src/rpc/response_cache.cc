@@ -0,0 +1,105 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <torrent/exceptions.h>
+
+#include "globals.h"
+#include "response_cache.h"
+
+namespace rpc {
+
+void
+ResponseCache::set_ttl(int64_t ms) {
+  if (ms < 0 || ms > 60 * 1000)
+    throw torrent::input_error("Invalid RPC cache time-to-live.");
+
+  m_ttl = ms;
+
+  if (m_ttl == 0)
+    m_entries.clear();
+}
+
+const std::string*
+ResponseCache::find(const char* request, uint32_t length) {
+  map_type::iterator itr = m_entries.find(hash(request, length));
+
+  if (itr == m_entries.end() ||
+      itr->second.m_time + rak::timer::from_milliseconds(m_ttl) <= cachedTime ||
+      itr->second.m_request.compare(0, std::string::npos, request, length) != 0) {
+    m_misses++;
+    return NULL;
+  }
+
+  m_hits++;
+  return &itr->second.m_response;
+}
+
+void
+ResponseCache::insert(const char* request, uint32_t length, const char* response, uint32_t responseLength) {
+  if (m_entries.size() >= max_entries) {
+    rak::timer expired = cachedTime - rak::timer::from_milliseconds(m_ttl);
+
+    for (map_type::iterator itr = m_entries.begin(); itr != m_entries.end(); )
+      if (itr->second.m_time <= expired)
+        m_entries.erase(itr++);
+      else
+        itr++;
+
+    if (m_entries.size() >= max_entries)
+      m_entries.clear();
+  }
+
+  entry_type& entry = m_entries[hash(request, length)];
+
+  entry.m_request.assign(request, length);
+  entry.m_response.assign(response, responseLength);
+  entry.m_time = cachedTime;
+}
+
+// 64 bit FNV-1a.
+uint64_t
+ResponseCache::hash(const char* request, uint32_t length) {
+  uint64_t result = 14695981039346656037ull;
+
+  for (const char* last = request + length; request != last; ++request)
+    result = (result ^ (unsigned char)*request) * 1099511628211ull;
+
+  return result;
+}
+
+}
@@ -0,0 +1,93 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_RESPONSE_CACHE_H
+#define RTORRENT_RPC_RESPONSE_CACHE_H
+
+#include <map>
+#include <string>
+#include <inttypes.h>
+#include <rak/timer.h>
+
+namespace rpc {
+
+// Short-lived cache of complete RPC responses keyed on a hash of the
+// request body. XmlRpc::process only stores responses of requests
+// that called nothing but read-only commands, and clears the cache
+// whenever a request calls any other command.
+
+class ResponseCache {
+public:
+  static const size_t max_entries = 64;
+
+  struct entry_type {
+    std::string       m_request;
+    std::string       m_response;
+    rak::timer        m_time;
+  };
+
+  typedef std::map<uint64_t, entry_type> map_type;
+
+  ResponseCache() : m_ttl(0), m_hits(0), m_misses(0) {}
+
+  bool                is_enabled() const                   { return m_ttl != 0; }
+
+  // Time-to-live of entries in milliseconds, zero disables the cache.
+  int64_t             ttl() const                          { return m_ttl; }
+  void                set_ttl(int64_t ms);
+
+  uint64_t            hits() const                         { return m_hits; }
+  uint64_t            misses() const                       { return m_misses; }
+  size_t              size() const                         { return m_entries.size(); }
+
+  const std::string*  find(const char* request, uint32_t length);
+  void                insert(const char* request, uint32_t length, const char* response, uint32_t responseLength);
+
+  void                clear()                              { m_entries.clear(); }
+
+  static uint64_t     hash(const char* request, uint32_t length);
+
+private:
+  int64_t             m_ttl;
+  uint64_t            m_hits;
+  uint64_t            m_misses;
+
+  map_type            m_entries;
+};
+
+}
+
+#endif
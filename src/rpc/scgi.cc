@@ -166,4 +166,14 @@ SCgi::receive_call(SCgiTask* task, const char* buffer, uint32_t length) {
   return m_slotProcess(buffer, length, slotWrite);
 }
 
+bool
+SCgi::receive_metrics(SCgiTask* task) {
+  if (!m_slotMetrics.is_valid())
+    return false;
+
+  std::string text = m_slotMetrics();
+
+  return task->receive_write_type(text.c_str(), text.size(), "text/plain; version=0.0.4");
+}
+
 }
@@ -53,6 +53,7 @@ class SCgi : public torrent::Event {
 public:
   typedef rak::function2<bool, const char*, uint32_t>             slot_write;
   typedef rak::function3<bool, const char*, uint32_t, slot_write> slot_process;
+  typedef rak::function0<std::string>                             slot_metrics;
 
   static const int max_tasks = 10;
 
@@ -68,6 +69,7 @@ public:
   const std::string&  path() const { return m_path; }
 
   void                set_slot_process(slot_process::base_type* s) { m_slotProcess.set(s); }
+  void                set_slot_metrics(slot_metrics::base_type* s) { m_slotMetrics.set(s); }
 
   int                 log_fd() const     { return m_logFd; }
   void                set_log_fd(int fd) { m_logFd = fd; }
@@ -77,6 +79,7 @@ public:
   virtual void        event_error();
 
   bool                receive_call(SCgiTask* task, const char* buffer, uint32_t length);
+  bool                receive_metrics(SCgiTask* task);
 
   utils::SocketFd&    get_fd()            { return *reinterpret_cast<utils::SocketFd*>(&m_fileDesc); }
 
@@ -86,6 +89,7 @@ private:
   std::string         m_path;
   int                 m_logFd;
   slot_process        m_slotProcess;
+  slot_metrics        m_slotMetrics;
   SCgiTask            m_task[max_tasks];
 };
 
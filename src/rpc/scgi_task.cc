@@ -38,11 +38,13 @@
 
 #include <rak/error_number.h>
 #include <cstdio>
+#include <cstring>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <torrent/exceptions.h>
 #include <torrent/poll.h>
 
+#include "core/profiler.h"
 #include "utils/socket_fd.h"
 
 #include "control.h"
@@ -57,6 +59,25 @@
 
 namespace rpc {
 
+// Returns the value of 'key' in the nul-separated SCGI header block,
+// or NULL if not present.
+inline const char*
+scgi_find_header(const char* first, const char* last, const char* key) {
+  while (first < last) {
+    const char* value = first + std::strlen(first) + 1;
+
+    if (value >= last)
+      return NULL;
+
+    if (std::strcmp(first, key) == 0)
+      return value;
+
+    first = value + std::strlen(value) + 1;
+  }
+
+  return NULL;
+}
+
 // If bufferSize is zero then memcpy won't do anything.
 inline void
 SCgiTask::realloc_buffer(uint32_t size, const char* buffer, uint32_t bufferSize) {
@@ -144,9 +165,25 @@ SCgiTask::event_read() {
     char* contentPos;
     contentSize = strtol(current + 15, &contentPos, 0);
 
-    if (*contentPos != '\0' || contentSize <= 0 || contentSize > max_content_size)
+    if (*contentPos != '\0' || contentSize < 0 || contentSize > max_content_size)
       goto event_read_failed;
 
+    // A GET request without a body can't be an XML-RPC call, answer
+    // it with the metrics page instead.
+    if (contentSize == 0) {
+      const char* method = scgi_find_header(current, current + headerSize, "REQUEST_METHOD");
+
+      if (method == NULL || std::strcmp(method, "GET") != 0)
+        goto event_read_failed;
+
+      this_thread->poll()->remove_read(this);
+
+      if (!m_parent->receive_metrics(this))
+        close();
+
+      return;
+    }
+
     m_body = current + headerSize + 1;
     headerSize = std::distance(m_buffer, m_body);
 
@@ -172,7 +209,6 @@ SCgiTask::event_read() {
     return;
 
   this_thread->poll()->remove_read(this);
-  this_thread->poll()->insert_write(this);
 
   if (m_parent->log_fd() >= 0) {
     // Clean up logging, this is just plain ugly...
@@ -181,9 +217,21 @@ SCgiTask::event_read() {
     write(m_parent->log_fd(), "\n---\n", sizeof("\n---\n"));
   }
 
-  // Close if the call failed, else stay open to write back data.
-  if (!m_parent->receive_call(this, m_body, m_bufferSize - std::distance(m_buffer, m_body)))
+  // Close if the call failed, else stay open to write back data. The
+  // response might be written later if the call was handed to a
+  // worker thread.
+  bool result;
+  m_pending = true;
+
+  {
+    core::ProfileScope profileScope(control->profiler(), "rpc.scgi");
+    result = m_parent->receive_call(this, m_body, m_bufferSize - std::distance(m_buffer, m_body));
+  }
+
+  if (!result) {
+    m_pending = false;
     close();
+  }
 
   return;
 
@@ -216,18 +264,25 @@ SCgiTask::event_error() {
 }
 
 bool
-SCgiTask::receive_write(const char* buffer, uint32_t length) {
+SCgiTask::receive_write_type(const char* buffer, uint32_t length, const char* contentType) {
+  m_pending = false;
+
+  if (!is_open())
+    return false;
+
   // Need to cast due to a bug in MacOSX gcc-4.0.1.
   if (length + 256 > std::max(m_bufferSize, (unsigned int)default_buffer_size))
     realloc_buffer(length + 256, NULL, 0);
 
   // Who ever bothers to check the return value?
-  int headerSize = sprintf(m_buffer, "Status: 200 OK\r\nContent-Type: text/xml\r\nContent-Length: %i\r\n\r\n", length);
+  int headerSize = sprintf(m_buffer, "Status: 200 OK\r\nContent-Type: %s\r\nContent-Length: %i\r\n\r\n", contentType, length);
 
   m_position = m_buffer;
   m_bufferSize = length + headerSize;
   
   std::memcpy(m_buffer + headerSize, buffer, length);
+
+  this_thread->poll()->insert_write(this);
   event_write();
 
   return true;
@@ -53,10 +53,14 @@ public:
   static const          int max_header_size     = 2000;
   static const          int max_content_size    = (2 << 20);
 
-  SCgiTask() { m_fileDesc = -1; }
+  SCgiTask() : m_pending(false) { m_fileDesc = -1; }
 
   bool                is_open() const      { return m_fileDesc != -1; }
-  bool                is_available() const { return m_fileDesc == -1; }
+
+  // A task closed while its call is still being processed by a
+  // worker is kept until the response arrives, so that the response
+  // can't be written to a new connection.
+  bool                is_available() const { return m_fileDesc == -1 && !m_pending; }
 
   void                open(SCgi* parent, int fd);
   void                close();
@@ -65,7 +69,8 @@ public:
   virtual void        event_write();
   virtual void        event_error();
 
-  bool                receive_write(const char* buffer, uint32_t length);
+  bool                receive_write(const char* buffer, uint32_t length) { return receive_write_type(buffer, length, "text/xml"); }
+  bool                receive_write_type(const char* buffer, uint32_t length, const char* contentType);
 
   utils::SocketFd&    get_fd()            { return *reinterpret_cast<utils::SocketFd*>(&m_fileDesc); }
 
@@ -79,6 +84,8 @@ private:
   char*               m_body;
 
   unsigned int        m_bufferSize;
+
+  bool                m_pending;
 };
 
 }
@@ -0,0 +1,253 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <rak/error_number.h>
+#include <torrent/exceptions.h>
+#include <torrent/poll.h>
+#include <torrent/torrent.h>
+
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
+#include "globals.h"
+#include "worker_pool.h"
+
+namespace rpc {
+
+WorkerPool::WorkerPool() :
+  m_stopping(false),
+  m_signalFd(-1) {
+
+  m_fileDesc = -1;
+
+  pthread_mutex_init(&m_lock, NULL);
+  pthread_cond_init(&m_cond, NULL);
+}
+
+WorkerPool::~WorkerPool() {
+  stop();
+
+  pthread_cond_destroy(&m_cond);
+  pthread_mutex_destroy(&m_lock);
+}
+
+void
+WorkerPool::start(unsigned int threads) {
+  if (is_active())
+    throw torrent::internal_error("WorkerPool::start() called on an active pool.");
+
+  if (threads == 0 || threads > max_threads)
+    throw torrent::internal_error("WorkerPool::start() invalid number of threads.");
+
+#ifdef HAVE_SYS_EVENTFD_H
+  if ((m_fileDesc = ::eventfd(0, 0)) == -1)
+    throw torrent::resource_error("Could not create eventfd: " + std::string(rak::error_number::current().c_str()));
+
+  m_signalFd = m_fileDesc;
+#else
+  int fds[2];
+
+  if (::pipe(fds) == -1)
+    throw torrent::resource_error("Could not create pipe: " + std::string(rak::error_number::current().c_str()));
+
+  m_fileDesc = fds[0];
+  m_signalFd = fds[1];
+  ::fcntl(m_signalFd, F_SETFL, O_NONBLOCK);
+#endif
+
+  ::fcntl(m_fileDesc, F_SETFL, O_NONBLOCK);
+
+  this_thread->poll()->open(this);
+  this_thread->poll()->insert_read(this);
+  this_thread->poll()->insert_error(this);
+
+  m_stopping = false;
+
+  // Signals are left to the main thread.
+  sigset_t blocked;
+  sigset_t previous;
+
+  sigfillset(&blocked);
+  pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+
+  while (m_threads.size() != threads) {
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, &WorkerPool::thread_main, this) != 0)
+      break;
+
+    m_threads.push_back(thread);
+  }
+
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  if (m_threads.size() != threads) {
+    stop();
+    throw torrent::resource_error("Could not create worker threads.");
+  }
+}
+
+void
+WorkerPool::stop() {
+  if (m_fileDesc == -1)
+    return;
+
+  pthread_mutex_lock(&m_lock);
+  m_stopping = true;
+  pthread_cond_broadcast(&m_cond);
+  pthread_mutex_unlock(&m_lock);
+
+  for (thread_list::iterator itr = m_threads.begin(), last = m_threads.end(); itr != last; ++itr)
+    pthread_join(*itr, NULL);
+
+  m_threads.clear();
+
+  for (job_queue::iterator itr = m_pending.begin(), last = m_pending.end(); itr != last; ++itr)
+    delete *itr;
+
+  for (job_queue::iterator itr = m_done.begin(), last = m_done.end(); itr != last; ++itr)
+    delete *itr;
+
+  m_pending.clear();
+  m_done.clear();
+
+  this_thread->poll()->remove_read(this);
+  this_thread->poll()->remove_error(this);
+  this_thread->poll()->close(this);
+
+  if (m_signalFd != m_fileDesc)
+    ::close(m_signalFd);
+
+  ::close(m_fileDesc);
+
+  m_fileDesc = -1;
+  m_signalFd = -1;
+}
+
+void
+WorkerPool::push(WorkerJob* job) {
+  if (!is_active())
+    throw torrent::internal_error("WorkerPool::push() called on an inactive pool.");
+
+  pthread_mutex_lock(&m_lock);
+  m_pending.push_back(job);
+  pthread_cond_signal(&m_cond);
+  pthread_mutex_unlock(&m_lock);
+}
+
+void
+WorkerPool::event_read() {
+#ifdef HAVE_SYS_EVENTFD_H
+  uint64_t count;
+  ::read(m_fileDesc, &count, sizeof(count));
+#else
+  char buffer[64];
+  while (::read(m_fileDesc, buffer, sizeof(buffer)) > 0)
+    ;
+#endif
+
+  job_queue done;
+
+  pthread_mutex_lock(&m_lock);
+  done.swap(m_done);
+  pthread_mutex_unlock(&m_lock);
+
+  for (job_queue::iterator itr = done.begin(), last = done.end(); itr != last; ++itr)
+    (*itr)->complete();
+}
+
+void
+WorkerPool::event_write() {
+  throw torrent::internal_error("WorkerPool does not support write().");
+}
+
+void
+WorkerPool::event_error() {
+  throw torrent::internal_error("WorkerPool received an error event.");
+}
+
+// Only the job that makes the done queue non-empty wakes the main
+// thread, event_read() takes everything that was queued before it.
+void
+WorkerPool::signal_done() {
+#ifdef HAVE_SYS_EVENTFD_H
+  uint64_t count = 1;
+  ::write(m_signalFd, &count, sizeof(count));
+#else
+  char c = 0;
+  ::write(m_signalFd, &c, 1);
+#endif
+}
+
+void*
+WorkerPool::thread_main(void* arg) {
+  WorkerPool* pool = static_cast<WorkerPool*>(arg);
+
+  pthread_mutex_lock(&pool->m_lock);
+
+  while (true) {
+    while (!pool->m_stopping && pool->m_pending.empty())
+      pthread_cond_wait(&pool->m_cond, &pool->m_lock);
+
+    if (pool->m_stopping)
+      break;
+
+    WorkerJob* job = pool->m_pending.front();
+    pool->m_pending.pop_front();
+
+    pthread_mutex_unlock(&pool->m_lock);
+    job->work();
+    pthread_mutex_lock(&pool->m_lock);
+
+    pool->m_done.push_back(job);
+
+    if (pool->m_done.size() == 1)
+      pool->signal_done();
+  }
+
+  pthread_mutex_unlock(&pool->m_lock);
+  return NULL;
+}
+
+}
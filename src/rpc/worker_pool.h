@@ -0,0 +1,113 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#ifndef RTORRENT_RPC_WORKER_POOL_H
+#define RTORRENT_RPC_WORKER_POOL_H
+
+#include <deque>
+#include <vector>
+#include <pthread.h>
+#include <torrent/event.h>
+
+namespace rpc {
+
+// A job is handed to a worker thread by WorkerPool::push(), and once
+// work() has returned the pool calls complete() from the main
+// thread's poll loop. The job owns itself from then on, complete()
+// either deletes it or pushes it back to the pool for another round.
+//
+// work() must not throw and must not touch anything shared with the
+// main thread.
+
+class WorkerJob {
+public:
+  virtual ~WorkerJob() {}
+
+  virtual void        work() = 0;
+  virtual void        complete() = 0;
+};
+
+// Finished jobs are handed back through a mutex protected queue, the
+// main thread is woken by an eventfd, or a pipe where eventfd is not
+// available, registered with the poll manager.
+
+class WorkerPool : public torrent::Event {
+public:
+  typedef std::deque<WorkerJob*> job_queue;
+  typedef std::vector<pthread_t> thread_list;
+
+  static const unsigned int max_threads = 16;
+
+  WorkerPool();
+  ~WorkerPool();
+
+  bool                is_active() const { return !m_threads.empty(); }
+  unsigned int        size() const      { return m_threads.size(); }
+
+  void                start(unsigned int threads);
+
+  // Joins the threads and deletes the jobs that are still queued
+  // without completing them.
+  void                stop();
+
+  void                push(WorkerJob* job);
+
+  virtual void        event_read();
+  virtual void        event_write();
+  virtual void        event_error();
+
+private:
+  WorkerPool(const WorkerPool&);
+  void operator = (const WorkerPool&);
+
+  static void*        thread_main(void* arg);
+
+  void                signal_done();
+
+  pthread_mutex_t     m_lock;
+  pthread_cond_t      m_cond;
+
+  bool                m_stopping;
+  job_queue           m_pending;
+  job_queue           m_done;
+  thread_list         m_threads;
+
+  int                 m_signalFd;
+};
+
+}
+
+#endif
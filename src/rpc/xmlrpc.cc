@@ -41,9 +41,17 @@
 #include <xmlrpc-c/server.h>
 #endif
 
+#include <algorithm>
+#include <cstdio>
 #include <torrent/object.h>
 #include <torrent/exceptions.h>
 
+#include "core/manager.h"
+#include "core/profiler.h"
+#include "utils/utf8.h"
+
+#include "globals.h"
+#include "control.h"
 #include "xmlrpc.h"
 #include "parse_commands.h"
 
@@ -67,6 +75,37 @@ private:
 
 torrent::Object xmlrpc_to_object(xmlrpc_env* env, xmlrpc_value* value, int callType = 0, rpc::target_type* target = NULL);
 
+// Number of torrent::Object nodes decoded and encoded, used to
+// account the work done by each call to XmlRpc::process. Only
+// updated by the main thread, workers count into their job.
+static uint64_t xmlrpc_object_count = 0;
+
+// Set when a command called through the registry faults, so that
+// XmlRpc::process_call doesn't cache the fault response.
+static bool xmlrpc_fault = false;
+
+uint64_t
+xmlrpc_count_objects(const torrent::Object& object) {
+  uint64_t count = 1;
+
+  switch (object.type()) {
+  case torrent::Object::TYPE_LIST:
+    for (torrent::Object::list_const_iterator itr = object.as_list().begin(), last = object.as_list().end(); itr != last; itr++)
+      count += xmlrpc_count_objects(*itr);
+    break;
+
+  case torrent::Object::TYPE_MAP:
+    for (torrent::Object::map_const_iterator itr = object.as_map().begin(), last = object.as_map().end(); itr != last; itr++)
+      count += xmlrpc_count_objects(itr->second);
+    break;
+
+  default:
+    break;
+  }
+
+  return count;
+}
+
 inline torrent::Object
 xmlrpc_list_entry_to_object(xmlrpc_env* env, xmlrpc_value* src, int index) {
   xmlrpc_value* tmp;
@@ -129,87 +168,63 @@ xmlrpc_list_entry_to_value(xmlrpc_env* env, xmlrpc_value* src, int index) {
   }
 }
 
-// Consider making a helper function that creates a target_type from a
-// torrent::Object, then we can just use xmlrpc_to_object.
+// Files:    "<hash>:f<index>"
+// Trackers: "<hash>:t<index>"
 rpc::target_type
-xmlrpc_to_target(xmlrpc_env* env, xmlrpc_value* value) {
-  rpc::target_type target;
-
-  switch (xmlrpc_value_type(value)) {
-  case XMLRPC_TYPE_STRING:
-  {
-    const char* str;
-    xmlrpc_read_string(env, value, &str);
-
-    if (env->fault_occurred)
-      throw xmlrpc_error(env);
-
-    if (std::strlen(str) == 0) {
-      // When specifying void, we require a zero-length string.
-      ::free((void*)str);
-      return rpc::make_target();
-
-    } else if (std::strlen(str) < 40) {
-      ::free((void*)str);
-      throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Unsupported target type found.");
-    }
-
-    core::Download* download = xmlrpc.get_slot_find_download()(str);
+xmlrpc_string_to_target(const std::string& str) {
+  if (str.empty())
+    // When specifying void, we require a zero-length string.
+    return rpc::make_target();
 
-    if (download == NULL) {
-      ::free((void*)str);
-      throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Could not find info-hash.");
-    }
+  if (str.size() < 40)
+    throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Unsupported target type found.");
 
-    if (std::strlen(str) == 40) {
-      ::free((void*)str);
-      return rpc::make_target(download);
-    }
+  core::Download* download = xmlrpc.get_slot_find_download()(str.c_str());
 
-    if (std::strlen(str) < 42 || str[40] != ':') {
-      ::free((void*)str);
-      throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Unsupported target type found.");
-    }
+  if (download == NULL)
+    throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Could not find info-hash.");
 
-    // Files:    "<hash>:f<index>"
-    // Trackers: "<hash>:t<index>"
+  if (str.size() == 40)
+    return rpc::make_target(download);
 
-    int index;
-    const char* end;
+  if (str.size() < 42 || str[40] != ':' || (str[41] != 'f' && str[41] != 't'))
+    throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Unsupported target type found.");
 
-    switch (str[41]) {
-    case 'f':
-      end = str + 42;
-      index = ::strtol(str + 42, (char**)&end, 0);
+  const char* end;
+  int index = ::strtol(str.c_str() + 42, (char**)&end, 0);
 
-      if (*str == '\0' || *end != '\0')
-        throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Invalid index.");
+  if (end == str.c_str() + 42 || *end != '\0')
+    throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Invalid index.");
 
-      target = rpc::make_target(XmlRpc::call_file, xmlrpc.get_slot_find_file()(download, index));
-      break;
+  rpc::target_type target;
 
-    case 't':
-      end = str + 42;
-      index = ::strtol(str + 42, (char**)&end, 0);
+  if (str[41] == 'f')
+    target = rpc::make_target(XmlRpc::call_file, xmlrpc.get_slot_find_file()(download, index));
+  else
+    target = rpc::make_target(XmlRpc::call_tracker, xmlrpc.get_slot_find_tracker()(download, index));
 
-      if (*str == '\0' || *end != '\0')
-        throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Invalid index.");
+  // Check if the target pointer is NULL.
+  if (target.second == NULL)
+    throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Invalid index.");
 
-      target = rpc::make_target(XmlRpc::call_tracker, xmlrpc.get_slot_find_tracker()(download, index));
-      break;
+  return target;
+}
 
-    default:
-      ::free((void*)str);
-      throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Unsupported target type found.");
-    }
+rpc::target_type
+xmlrpc_to_target(xmlrpc_env* env, xmlrpc_value* value) {
+  switch (xmlrpc_value_type(value)) {
+  case XMLRPC_TYPE_STRING:
+  {
+    const char* valueString;
+    xmlrpc_read_string(env, value, &valueString);
 
-    ::free((void*)str);
+    if (env->fault_occurred)
+      throw xmlrpc_error(env);
 
-    // Check if the target pointer is NULL.
-    if (target.second == NULL)
-      throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Invalid index.");
+    std::string str(valueString);
+    ::free((void*)valueString);
 
-    return target;
+    return xmlrpc_string_to_target(str);
   }
 
   default:
@@ -233,6 +248,72 @@ xmlrpc_to_index_type(int index, int callType, core::Download* download) {
   return rpc::make_target(callType, result);
 }
 
+int64_t
+xmlrpc_object_to_value(const torrent::Object& object) {
+  switch (object.type()) {
+  case torrent::Object::TYPE_VALUE:
+    return object.as_value();
+
+  case torrent::Object::TYPE_STRING:
+  {
+    const char* str = object.as_string().c_str();
+    const char* end = str;
+    int64_t v = ::strtoll(str, (char**)&end, 0);
+
+    if (*str == '\0' || *end != '\0')
+      throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Invalid index.");
+
+    return v;
+  }
+
+  default:
+    throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Invalid type found.");
+  }
+}
+
+rpc::target_type
+xmlrpc_object_to_target(const torrent::Object& object) {
+  if (!object.is_string())
+    return rpc::make_target();
+
+  return xmlrpc_string_to_target(object.as_string());
+}
+
+// Splits the target off the list of parameters decoded by a worker,
+// leaving the same arguments and target as xmlrpc_to_object does for
+// the parameter array in xmlrpc_call_command.
+void
+xmlrpc_split_target(torrent::Object& args, int callType, rpc::target_type* target) {
+  torrent::Object::list_type& argsList = args.as_list();
+
+  if (callType != XmlRpc::call_generic) {
+    if (argsList.empty())
+      throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Too few arguments.");
+
+    *target = xmlrpc_object_to_target(argsList.front());
+    argsList.pop_front();
+
+    if (target->first == XmlRpc::call_download &&
+        (callType == XmlRpc::call_file || callType == XmlRpc::call_tracker)) {
+      // See xmlrpc_to_object.
+      if (argsList.empty())
+        throw xmlrpc_error(XMLRPC_TYPE_ERROR, "Too few arguments.");
+
+      *target = xmlrpc_to_index_type(xmlrpc_object_to_value(argsList.front()), callType, (core::Download*)target->second);
+      argsList.pop_front();
+    }
+  }
+
+  if (argsList.size() == 1) {
+    torrent::Object tmp;
+    tmp.swap(argsList.front());
+    args.swap(tmp);
+
+  } else if (argsList.empty()) {
+    args = torrent::Object();
+  }
+}
+
 torrent::Object
 xmlrpc_to_object(xmlrpc_env* env, xmlrpc_value* value, int callType, rpc::target_type* target) {
   switch (xmlrpc_value_type(value)) {
@@ -271,7 +352,9 @@ xmlrpc_to_object(xmlrpc_env* env, xmlrpc_value* value, int callType, rpc::target
       if (env->fault_occurred)
         throw xmlrpc_error(env);
 
-      torrent::Object result = torrent::Object(std::string(valueString));
+      // Assign in place to avoid copying through a temporary string.
+      torrent::Object result = torrent::Object(std::string());
+      result.as_string().assign(valueString);
 
       // Urgh, seriously?
       ::free((void*)valueString);
@@ -288,7 +371,8 @@ xmlrpc_to_object(xmlrpc_env* env, xmlrpc_value* value, int callType, rpc::target
     if (env->fault_occurred)
       throw xmlrpc_error(env);
 
-    torrent::Object result = torrent::Object(std::string(valueString, valueSize));
+    torrent::Object result = torrent::Object(std::string());
+    result.as_string().assign(valueString, valueSize);
 
     // Urgh, seriously?
     ::free((void*)valueString);
@@ -336,8 +420,11 @@ xmlrpc_to_object(xmlrpc_env* env, xmlrpc_value* value, int callType, rpc::target
       torrent::Object result = torrent::Object::create_list();
       torrent::Object::list_type& listRef = result.as_list();
 
-      while (current != last)
-        listRef.push_back(xmlrpc_list_entry_to_object(env, value, current++));
+      // Swap the entries into place, push_back would deep-copy them.
+      while (current != last) {
+        listRef.push_back(torrent::Object());
+        xmlrpc_list_entry_to_object(env, value, current++).swap(listRef.back());
+      }
 
       return result;
 
@@ -358,13 +445,15 @@ xmlrpc_to_object(xmlrpc_env* env, xmlrpc_value* value, int callType, rpc::target
   }
 }
 
+// Called by workers, so the dialect is passed rather than read from
+// the global XmlRpc object.
 xmlrpc_value*
-object_to_xmlrpc(xmlrpc_env* env, const torrent::Object& object) {
+object_to_xmlrpc(xmlrpc_env* env, const torrent::Object& object, int dialect) {
   switch (object.type()) {
   case torrent::Object::TYPE_VALUE:
 
 #ifdef XMLRPC_HAVE_I8
-    if (xmlrpc.dialect() != XmlRpc::dialect_generic)
+    if (dialect != XmlRpc::dialect_generic)
       return xmlrpc_i8_new(env, object.as_value());
 #else
     return xmlrpc_int_new(env, object.as_value());
@@ -372,28 +461,24 @@ object_to_xmlrpc(xmlrpc_env* env, const torrent::Object& object) {
 
   case torrent::Object::TYPE_STRING:
   {
+    const std::string& str = object.as_string();
+
 #ifdef XMLRPC_HAVE_I8
     // The versions that support I8 do implicit utf-8 validation.
-    xmlrpc_value* result = xmlrpc_string_new(env, object.as_string().c_str());
+    xmlrpc_value* result = xmlrpc_string_new(env, str.c_str());
 #else
     // In older versions, xmlrpc-c doesn't validate the utf-8 encoding itself.
-    xmlrpc_validate_utf8(env, object.as_string().c_str(), object.as_string().length());
-
-    xmlrpc_value* result = env->fault_occurred ? NULL : xmlrpc_string_new(env, object.as_string().c_str());
+    xmlrpc_value* result = utils::utf8_validate(str.data(), str.data() + str.size()) ? xmlrpc_string_new(env, str.c_str()) : NULL;
 #endif
 
-    if (env->fault_occurred) {
+    if (result == NULL || env->fault_occurred) {
       xmlrpc_env_clean(env);
       xmlrpc_env_init(env);
 
-      const std::string& str = object.as_string();
-      char buffer[str.size() + 1];
-      char* dst = buffer;
-      for (std::string::const_iterator itr = str.begin(); itr != str.end(); ++itr)
-        *dst++ = ((*itr < 0x20 && *itr != '\r' && *itr != '\n' && *itr != '\t') || (*itr & 0x80)) ? '?' : *itr;
-      *dst = 0;
+      std::string buffer;
+      utils::utf8_sanitize(buffer, str.data(), str.data() + str.size());
 
-      result = xmlrpc_string_new(env, buffer);
+      result = xmlrpc_string_new(env, buffer.c_str());
     }
 
     return result;
@@ -404,7 +489,7 @@ object_to_xmlrpc(xmlrpc_env* env, const torrent::Object& object) {
     xmlrpc_value* result = xmlrpc_array_new(env);
     
     for (torrent::Object::list_const_iterator itr = object.as_list().begin(), last = object.as_list().end(); itr != last; itr++) {
-      xmlrpc_value* item = object_to_xmlrpc(env, *itr);
+      xmlrpc_value* item = object_to_xmlrpc(env, *itr, dialect);
       xmlrpc_array_append_item(env, result, item);
       xmlrpc_DECREF(item);
     }
@@ -417,7 +502,7 @@ object_to_xmlrpc(xmlrpc_env* env, const torrent::Object& object) {
     xmlrpc_value* result = xmlrpc_struct_new(env);
     
     for (torrent::Object::map_const_iterator itr = object.as_map().begin(), last = object.as_map().end(); itr != last; itr++) {
-      xmlrpc_value* item = object_to_xmlrpc(env, itr->second);
+      xmlrpc_value* item = object_to_xmlrpc(env, itr->second, dialect);
       xmlrpc_struct_set_value(env, result, itr->first.c_str(), item);
       xmlrpc_DECREF(item);
     }
@@ -436,33 +521,279 @@ xmlrpc_call_command(xmlrpc_env* env, xmlrpc_value* args, void* voidServerInfo) {
 
   if (itr == commands.end()) {
     xmlrpc_env_set_fault(env, XMLRPC_PARSE_ERROR, ("Command \"" + std::string((const char*)voidServerInfo) + "\" does not exist.").c_str());
+    xmlrpc_fault = true;
     return NULL;
   }
 
+  // The XML parsing and serialization done by xmlrpc-c is accounted
+  // as 'rpc.process' minus the three phases below.
+  core::Profiler* profiler = control->profiler();
+
   try {
     torrent::Object object;
+    torrent::Object result;
     rpc::target_type target = rpc::make_target();
 
-    if (itr->second.m_flags & CommandMap::flag_no_target)
-      xmlrpc_to_object(env, args, XmlRpc::call_generic, &target).swap(object);
-    else
-      xmlrpc_to_object(env, args, itr->second.target(), &target).swap(object);
+    {
+      core::ProfileScope profileScope(profiler, "rpc.decode");
 
-    if (env->fault_occurred)
+      if (itr->second.m_flags & CommandMap::flag_no_target)
+        xmlrpc_to_object(env, args, XmlRpc::call_generic, &target).swap(object);
+      else
+        xmlrpc_to_object(env, args, itr->second.target(), &target).swap(object);
+
+      xmlrpc_object_count += xmlrpc_count_objects(object);
+    }
+
+    if (env->fault_occurred) {
+      xmlrpc_fault = true;
       return NULL;
+    }
+
+    {
+      core::ProfileScope profileScope(profiler, "rpc.execute");
+      rpc::commands.call_command(itr, object, target).swap(result);
+    }
 
-    return object_to_xmlrpc(env, rpc::commands.call_command(itr, object, target));
+    core::ProfileScope profileScope(profiler, "rpc.encode");
+    xmlrpc_object_count += xmlrpc_count_objects(result);
+
+    xmlrpc_value* value = object_to_xmlrpc(env, result, xmlrpc.dialect());
+    xmlrpc_fault = xmlrpc_fault || env->fault_occurred;
+
+    return value;
 
   } catch (xmlrpc_error& e) {
     xmlrpc_env_set_fault(env, e.type(), e.what());
+    xmlrpc_fault = true;
     return NULL;
 
   } catch (torrent::local_error& e) {
     xmlrpc_env_set_fault(env, XMLRPC_PARSE_ERROR, e.what());
+    xmlrpc_fault = true;
     return NULL;
   }
 }
 
+// A call processed through the worker pool. The request is parsed
+// and decoded by a worker, the command is executed by the main
+// thread, and the result is encoded and serialized by a worker.
+// Calls that aren't to a public command, e.g. 'system.multicall',
+// are handed to the xmlrpc-c registry on the main thread instead.
+
+class XmlRpcJob : public WorkerJob {
+public:
+  XmlRpcJob(const char* inBuffer, uint32_t length, rak::timer captureStart, XmlRpc::slot_write::base_type* slotWrite, int dialect) :
+    m_state(state_decode), m_request(inBuffer, length), m_captureStart(captureStart), m_dialect(dialect),
+    m_fault(false), m_faultCode(0), m_mutated(false), m_generation(0), m_objects(0) { m_slotWrite.set(slotWrite); }
+
+  virtual void        work();
+  virtual void        complete();
+
+private:
+  static const int state_decode = 0;
+  static const int state_encode = 1;
+
+  void                set_fault(int code, const char* msg);
+
+  void                decode();
+  void                execute();
+  void                encode();
+
+  int                 m_state;
+
+  std::string         m_request;
+  rak::timer          m_captureStart;
+  XmlRpc::slot_write  m_slotWrite;
+  int                 m_dialect;
+
+  std::string         m_method;
+  torrent::Object     m_object;
+
+  bool                m_fault;
+  int                 m_faultCode;
+  std::string         m_faultString;
+
+  bool                m_mutated;
+  uint64_t            m_generation;
+  uint64_t            m_objects;
+
+  std::string         m_response;
+};
+
+void
+XmlRpcJob::set_fault(int code, const char* msg) {
+  m_fault = true;
+  m_faultCode = code;
+  m_faultString = msg;
+}
+
+void
+XmlRpcJob::work() {
+  if (m_state == state_decode)
+    decode();
+  else
+    encode();
+}
+
+void
+XmlRpcJob::complete() {
+  if (m_state == state_encode) {
+    xmlrpc.finish(m_request.data(), m_request.size(), m_captureStart, m_fault, m_mutated, m_generation,
+                  m_objects, m_response.data(), m_response.size(), m_slotWrite);
+    delete this;
+    return;
+  }
+
+  CommandMap::const_iterator itr = commands.find(m_method.c_str());
+
+  if (itr == commands.end() || !(itr->second.m_flags & CommandMap::flag_public_xmlrpc)) {
+    xmlrpc.process_call(m_request.data(), m_request.size(), m_captureStart, m_slotWrite);
+    delete this;
+    return;
+  }
+
+  if (!m_fault)
+    execute();
+
+  m_generation = xmlrpc.m_cacheGeneration;
+  m_state = state_encode;
+  xmlrpc.workers()->push(this);
+}
+
+// Worker thread. A failure is only recorded, complete() decides if
+// the fault is returned or the registry gets to handle the call.
+void
+XmlRpcJob::decode() {
+  xmlrpc_env localEnv;
+  xmlrpc_env_init(&localEnv);
+
+  const char*   methodName;
+  xmlrpc_value* params;
+
+  xmlrpc_parse_call(&localEnv, m_request.data(), m_request.size(), &methodName, &params);
+
+  if (localEnv.fault_occurred) {
+    xmlrpc_env_clean(&localEnv);
+    return;
+  }
+
+  m_method = methodName;
+  ::free((void*)methodName);
+
+  // Keep every parameter, even a single one, so that the main thread
+  // splits off the target exactly as xmlrpc_call_command would.
+  try {
+    unsigned int size = xmlrpc_array_size(&localEnv, params);
+
+    if (localEnv.fault_occurred)
+      throw xmlrpc_error(&localEnv);
+
+    m_object = torrent::Object::create_list();
+
+    for (unsigned int index = 0; index != size; index++) {
+      m_object.as_list().push_back(torrent::Object());
+      xmlrpc_list_entry_to_object(&localEnv, params, index).swap(m_object.as_list().back());
+    }
+
+    m_objects += xmlrpc_count_objects(m_object);
+
+  } catch (xmlrpc_error& e) {
+    set_fault(e.type(), e.what());
+  } catch (torrent::local_error& e) {
+    set_fault(XMLRPC_PARSE_ERROR, e.what());
+  }
+
+  if (!m_fault && localEnv.fault_occurred)
+    set_fault(localEnv.fault_code, localEnv.fault_string);
+
+  xmlrpc_DECREF(params);
+  xmlrpc_env_clean(&localEnv);
+}
+
+void
+XmlRpcJob::execute() {
+  CommandMap::const_iterator itr = commands.find(m_method.c_str());
+
+  commands.set_mutated(false);
+
+  try {
+    core::ProfileScope profileScope(control->profiler(), "rpc.execute");
+
+    rpc::target_type target = rpc::make_target();
+
+    if (itr->second.m_flags & CommandMap::flag_no_target)
+      xmlrpc_split_target(m_object, XmlRpc::call_generic, &target);
+    else
+      xmlrpc_split_target(m_object, itr->second.target(), &target);
+
+    rpc::commands.call_command(itr, m_object, target).swap(m_object);
+
+  } catch (xmlrpc_error& e) {
+    set_fault(e.type(), e.what());
+  } catch (torrent::local_error& e) {
+    set_fault(XMLRPC_PARSE_ERROR, e.what());
+  }
+
+  m_mutated = commands.is_mutated();
+  xmlrpc.executed(m_mutated);
+}
+
+// Worker thread.
+void
+XmlRpcJob::encode() {
+  xmlrpc_env localEnv;
+  xmlrpc_env_init(&localEnv);
+
+  xmlrpc_mem_block* memblock = xmlrpc_mem_block_new(&localEnv, 0);
+
+  if (!m_fault) {
+    m_objects += xmlrpc_count_objects(m_object);
+
+    try {
+      xmlrpc_value* value = object_to_xmlrpc(&localEnv, m_object, m_dialect);
+
+      if (!localEnv.fault_occurred) {
+#ifdef XMLRPC_HAVE_I8
+        xmlrpc_serialize_response2(&localEnv, memblock, value, m_dialect == XmlRpc::dialect_apache ? xmlrpc_dialect_apache : xmlrpc_dialect_i8);
+#else
+        xmlrpc_serialize_response(&localEnv, memblock, value);
+#endif
+      }
+
+      if (value != NULL)
+        xmlrpc_DECREF(value);
+
+      if (localEnv.fault_occurred)
+        set_fault(localEnv.fault_code, localEnv.fault_string);
+
+    } catch (torrent::local_error& e) {
+      set_fault(XMLRPC_PARSE_ERROR, e.what());
+    }
+
+    // Release the result here rather than on the main thread.
+    m_object = torrent::Object();
+  }
+
+  if (m_fault) {
+    xmlrpc_env faultEnv;
+    xmlrpc_env_init(&faultEnv);
+    xmlrpc_env_set_fault(&faultEnv, m_faultCode, m_faultString.c_str());
+
+    xmlrpc_env_clean(&localEnv);
+    xmlrpc_env_init(&localEnv);
+
+    xmlrpc_mem_block_resize(&localEnv, memblock, 0);
+    xmlrpc_serialize_fault(&localEnv, memblock, &faultEnv);
+    xmlrpc_env_clean(&faultEnv);
+  }
+
+  m_response.assign((const char*)xmlrpc_mem_block_contents(memblock), xmlrpc_mem_block_size(memblock));
+
+  xmlrpc_mem_block_free(memblock);
+  xmlrpc_env_clean(&localEnv);
+}
+
 void
 XmlRpc::initialize() {
 #ifndef XMLRPC_HAVE_I8
@@ -470,6 +801,7 @@ XmlRpc::initialize() {
 #endif
   
   m_env = new xmlrpc_env;
+  m_initialized = rak::timer::current();
 
   xmlrpc_env_init((xmlrpc_env*)m_env);
   m_registry = xmlrpc_registry_new((xmlrpc_env*)m_env);
@@ -477,6 +809,8 @@ XmlRpc::initialize() {
 
 void
 XmlRpc::cleanup() {
+  m_workers.stop();
+
   if (!is_valid())
     return;
 
@@ -485,21 +819,167 @@ XmlRpc::cleanup() {
   delete (xmlrpc_env*)m_env;
 }
 
+void
+XmlRpc::register_commands() {
+  rak::timer start = rak::timer::current();
+  unsigned int count = 0;
+
+  m_registered = true;
+
+  for (CommandMap::const_iterator itr = commands.begin(), last = commands.end(); itr != last; itr++) {
+    if (!(itr->second.m_flags & CommandMap::flag_public_xmlrpc))
+      continue;
+
+    insert_command(itr->first, itr->second.m_parm, itr->second.m_doc);
+    count++;
+  }
+
+  char buffer[128];
+  snprintf(buffer, 128, "XMLRPC registered %u functions in %u ms, first request %u ms after initialization.",
+           count, (unsigned int)((rak::timer::current() - start).usec() / 1000), (unsigned int)((start - m_initialized).usec() / 1000));
+
+  control->core()->push_log(buffer);
+}
+
+const std::string*
+XmlRpc::find_cached(const char* inBuffer, uint32_t length, rak::timer captureStart) {
+  if (!m_cache.is_enabled())
+    return NULL;
+
+  const std::string* response = m_cache.find(inBuffer, length);
+
+  if (response != NULL && m_capture.is_open())
+    m_capture.write(captureStart.usec(), (rak::timer::current() - captureStart).usec(), false, inBuffer, length, response->size());
+
+  return response;
+}
+
+// Any command that isn't read-only might have changed what cached
+// responses would return. The generation keeps calls that were
+// executed before the change from being cached after it.
+void
+XmlRpc::executed(bool mutated) {
+  if (!mutated)
+    return;
+
+  m_cache.clear();
+  m_cacheGeneration++;
+}
+
+bool
+XmlRpc::finish(const char* inBuffer, uint32_t length, rak::timer captureStart, bool fault, bool mutated, uint64_t generation,
+               uint64_t objects, const char* response, uint32_t responseLength, slot_write slotWrite) {
+  m_statsRequests++;
+  m_statsObjectsLast = objects;
+  m_statsObjects += m_statsObjectsLast;
+  m_statsObjectsPeak = std::max(m_statsObjectsPeak, m_statsObjectsLast);
+
+  // Faults may be transient, e.g. a target that doesn't exist yet.
+  if (m_cache.is_enabled() && !fault && !mutated && generation == m_cacheGeneration)
+    m_cache.insert(inBuffer, length, response, responseLength);
+
+  if (m_capture.is_open())
+    m_capture.write(captureStart.usec(), (rak::timer::current() - captureStart).usec(), mutated,
+                    inBuffer, length, responseLength);
+
+  return slotWrite(response, responseLength);
+}
+
 bool
 XmlRpc::process(const char* inBuffer, uint32_t length, slot_write slotWrite) {
+  if (!m_registered)
+    register_commands();
+
+  rak::timer captureStart = m_capture.is_open() ? rak::timer::current() : rak::timer();
+  const std::string* response = find_cached(inBuffer, length, captureStart);
+
+  if (response != NULL)
+    return slotWrite(response->data(), response->size());
+
+  return process_call(inBuffer, length, captureStart, slotWrite);
+}
+
+bool
+XmlRpc::process_async(const char* inBuffer, uint32_t length, slot_write slotWrite) {
+  if (!m_workers.is_active())
+    return process(inBuffer, length, slotWrite);
+
+  if (!m_registered)
+    register_commands();
+
+  rak::timer captureStart = m_capture.is_open() ? rak::timer::current() : rak::timer();
+  const std::string* response = find_cached(inBuffer, length, captureStart);
+
+  if (response != NULL)
+    return slotWrite(response->data(), response->size());
+
+  m_workers.push(new XmlRpcJob(inBuffer, length, captureStart, slotWrite.release(), m_dialect));
+  return true;
+}
+
+bool
+XmlRpc::process_uncached(const char* inBuffer, uint32_t length, slot_write slotWrite) {
+  if (!m_registered)
+    register_commands();
+
   xmlrpc_env localEnv;
   xmlrpc_env_init(&localEnv);
 
+  commands.set_mutated(false);
+
   xmlrpc_mem_block* memblock = xmlrpc_registry_process_call(&localEnv, (xmlrpc_registry*)m_registry, NULL, inBuffer, length);
 
-  bool result = slotWrite((const char*)xmlrpc_mem_block_contents(memblock),
-                          xmlrpc_mem_block_size(memblock));
+  executed(commands.is_mutated());
+
+  bool result = slotWrite((const char*)xmlrpc_mem_block_contents(memblock), xmlrpc_mem_block_size(memblock));
+
+  xmlrpc_mem_block_free(memblock);
+  xmlrpc_env_clean(&localEnv);
+  return result;
+}
+
+bool
+XmlRpc::process_call(const char* inBuffer, uint32_t length, rak::timer captureStart, slot_write slotWrite) {
+  xmlrpc_env localEnv;
+  xmlrpc_env_init(&localEnv);
+
+  commands.set_mutated(false);
+
+  uint64_t objectCount = xmlrpc_object_count;
+  xmlrpc_mem_block* memblock;
+
+  xmlrpc_fault = false;
+
+  {
+    core::ProfileScope profileScope(control->profiler(), "rpc.process");
+    memblock = xmlrpc_registry_process_call(&localEnv, (xmlrpc_registry*)m_registry, NULL, inBuffer, length);
+  }
+
+  executed(commands.is_mutated());
+
+  bool result = finish(inBuffer, length, captureStart, xmlrpc_fault || localEnv.fault_occurred, commands.is_mutated(),
+                       m_cacheGeneration, xmlrpc_object_count - objectCount,
+                       (const char*)xmlrpc_mem_block_contents(memblock), xmlrpc_mem_block_size(memblock), slotWrite);
 
   xmlrpc_mem_block_free(memblock);
   xmlrpc_env_clean(&localEnv);
   return result;
 }
 
+void
+XmlRpc::set_workers_size(int64_t size) {
+  if (size < 0 || size > (int64_t)WorkerPool::max_threads)
+    throw torrent::input_error("Invalid number of XMLRPC workers.");
+
+  if (control->scgi() != NULL)
+    throw torrent::input_error("Cannot change the number of XMLRPC workers after the SCGI socket is opened.");
+
+  m_workers.stop();
+
+  if (size != 0)
+    m_workers.start(size);
+}
+
 void
 XmlRpc::insert_command(const char* name, const char* parm, const char* doc) {
   xmlrpc_env localEnv;
@@ -572,6 +1052,10 @@ void XmlRpc::insert_command(__UNUSED const char* name, __UNUSED const char* parm
 void XmlRpc::set_dialect(__UNUSED int dialect) {}
 
 bool XmlRpc::process(__UNUSED const char* inBuffer, __UNUSED uint32_t length, __UNUSED slot_write slotWrite) { return false; }
+bool XmlRpc::process_async(__UNUSED const char* inBuffer, __UNUSED uint32_t length, __UNUSED slot_write slotWrite) { return false; }
+bool XmlRpc::process_uncached(__UNUSED const char* inBuffer, __UNUSED uint32_t length, __UNUSED slot_write slotWrite) { return false; }
+
+void XmlRpc::set_workers_size(__UNUSED int64_t size) { throw torrent::input_error("XMLRPC not supported."); }
 
 int64_t XmlRpc::size_limit() { return 0; }
 void    XmlRpc::set_size_limit(uint64_t size) {}
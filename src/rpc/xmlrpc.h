@@ -38,6 +38,11 @@
 #define RTORRENT_RPC_XMLRPC_H
 
 #include <rak/functional_fun.h>
+#include <rak/timer.h>
+
+#include "capture.h"
+#include "response_cache.h"
+#include "worker_pool.h"
 
 namespace core {
   class Download;
@@ -51,6 +56,8 @@ namespace torrent {
 
 namespace rpc {
 
+class XmlRpcJob;
+
 class XmlRpc {
 public:
   typedef rak::function1<core::Download*, const char*>                 slot_find_download;
@@ -71,15 +78,32 @@ public:
   static const int call_file       = 5;
   static const int call_file_itr   = 6;
 
-  XmlRpc() : m_env(NULL), m_registry(NULL), m_dialect(dialect_i8) {}
+  XmlRpc() : m_env(NULL), m_registry(NULL), m_registered(false), m_dialect(dialect_i8),
+             m_statsRequests(0), m_statsObjects(0), m_statsObjectsLast(0), m_statsObjectsPeak(0),
+             m_cacheGeneration(0) {}
 
   bool                is_valid() const { return m_env != NULL; }
 
+  // Public commands are registered with xmlrpc-c on the first call to
+  // process() rather than when initialized, commands inserted after
+  // that are registered as they are added.
+  bool                is_registered() const { return m_registered; }
+
   void                initialize();
   void                cleanup();
 
   bool                process(const char* inBuffer, uint32_t length, slot_write slotWrite);
 
+  // Like process(), but when workers are running the XML parsing and
+  // serialization is done on a worker thread and slotWrite is called
+  // later from the main thread. Only the command itself is executed
+  // on the main thread.
+  bool                process_async(const char* inBuffer, uint32_t length, slot_write slotWrite);
+
+  // Bypasses the response cache, capture log and statistics, for
+  // measuring the call itself.
+  bool                process_uncached(const char* inBuffer, uint32_t length, slot_write slotWrite);
+
   void                insert_command(const char* name, const char* parm, const char* doc);
 
   int                 dialect() { return m_dialect; }
@@ -97,12 +121,50 @@ public:
   static int64_t      size_limit();
   static void         set_size_limit(uint64_t size);
 
+  // Number of objects decoded and encoded by process(), a measure of
+  // the allocations done per request.
+  uint64_t            stats_requests() const                      { return m_statsRequests; }
+  uint64_t            stats_objects() const                       { return m_statsObjects; }
+  uint64_t            stats_objects_last() const                  { return m_statsObjectsLast; }
+  uint64_t            stats_objects_peak() const                  { return m_statsObjectsPeak; }
+
+  ResponseCache*      cache()                                     { return &m_cache; }
+  CaptureLog*         capture()                                   { return &m_capture; }
+  WorkerPool*         workers()                                   { return &m_workers; }
+
+  // The number of worker threads may only be changed before the SCGI
+  // socket is opened, zero processes all calls on the main thread.
+  int64_t             workers_size() const                        { return m_workers.size(); }
+  void                set_workers_size(int64_t size);
+
 private:
+  friend class XmlRpcJob;
+
+  void                register_commands();
+
+  const std::string*  find_cached(const char* inBuffer, uint32_t length, rak::timer captureStart);
+  bool                process_call(const char* inBuffer, uint32_t length, rak::timer captureStart, slot_write slotWrite);
+  void                executed(bool mutated);
+  bool                finish(const char* inBuffer, uint32_t length, rak::timer captureStart, bool fault, bool mutated, uint64_t generation,
+                             uint64_t objects, const char* response, uint32_t responseLength, slot_write slotWrite);
+
   void*               m_env;
   void*               m_registry;
+  bool                m_registered;
+  rak::timer          m_initialized;
 
   int                 m_dialect;
 
+  uint64_t            m_statsRequests;
+  uint64_t            m_statsObjects;
+  uint64_t            m_statsObjectsLast;
+  uint64_t            m_statsObjectsPeak;
+
+  ResponseCache       m_cache;
+  uint64_t            m_cacheGeneration;
+  CaptureLog          m_capture;
+  WorkerPool          m_workers;
+
   slot_find_download  m_slotFindDownload;
   slot_find_file      m_slotFindFile;
   slot_find_tracker   m_slotFindTracker;
@@ -0,0 +1,158 @@
+// rTorrent - BitTorrent client
+// Copyright (C) 2005-2008, Jari Sundell
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+// In addition, as a special exception, the copyright holders give
+// permission to link the code of portions of this program with the
+// OpenSSL library under certain conditions as described in each
+// individual source file, and distribute linked combinations
+// including the two.
+//
+// You must obey the GNU General Public License in all respects for
+// all of the code used other than OpenSSL.  If you modify file(s)
+// with this exception, you may extend this exception to your version
+// of the file(s), but you are not obligated to do so.  If you do not
+// wish to do so, delete this exception statement from your version.
+// If you delete this exception statement from all source files in the
+// program, then also delete it here.
+//
+// Contact:  Jari Sundell <jaris@ifi.uio.no>
+//
+//           Skomakerveien 33
+//           3185 Skoppum, NORWAY
+
+#include "config.h"
+
+#include <cstring>
+#include <inttypes.h>
+
+#include "utf8.h"
+
+namespace utils {
+
+// Plain ascii makes up nearly all of the strings passed through here,
+// so skip ahead a word at a time while no byte has the high bit set
+// and, if 'controlChars' is set, no byte is below 0x20.
+static inline const char*
+utf8_skip_ascii(const char* first, const char* last, bool controlChars) {
+  static const uint64_t high_bits = 0x8080808080808080ull;
+  static const uint64_t space     = 0x2020202020202020ull;
+
+  while (last - first >= 8) {
+    uint64_t word;
+    std::memcpy(&word, first, sizeof(word));
+
+    uint64_t mask = word;
+
+    if (controlChars)
+      mask |= (word - space) & ~word;
+
+    if (mask & high_bits)
+      break;
+
+    first += 8;
+  }
+
+  return first;
+}
+
+// Returns the length of the valid sequence starting at 'first', or
+// zero if it is malformed.
+static inline unsigned int
+utf8_sequence_length(const unsigned char* first, const unsigned char* last) {
+  unsigned int length;
+  uint32_t     codePoint;
+  uint32_t     minimum;
+
+  if (*first < 0x80) {
+    return 1;
+
+  } else if ((*first & 0xe0) == 0xc0) {
+    length = 2;
+    codePoint = *first & 0x1f;
+    minimum = 0x80;
+
+  } else if ((*first & 0xf0) == 0xe0) {
+    length = 3;
+    codePoint = *first & 0x0f;
+    minimum = 0x800;
+
+  } else if ((*first & 0xf8) == 0xf0) {
+    length = 4;
+    codePoint = *first & 0x07;
+    minimum = 0x10000;
+
+  } else {
+    return 0;
+  }
+
+  if ((unsigned int)(last - first) < length)
+    return 0;
+
+  for (unsigned int i = 1; i != length; ++i) {
+    if ((first[i] & 0xc0) != 0x80)
+      return 0;
+
+    codePoint = (codePoint << 6) | (first[i] & 0x3f);
+  }
+
+  if (codePoint < minimum || codePoint > 0x10ffff || (codePoint >= 0xd800 && codePoint <= 0xdfff))
+    return 0;
+
+  return length;
+}
+
+bool
+utf8_validate(const char* first, const char* last) {
+  while ((first = utf8_skip_ascii(first, last, false)) != last) {
+    unsigned int length = utf8_sequence_length((const unsigned char*)first, (const unsigned char*)last);
+
+    if (length == 0)
+      return false;
+
+    first += length;
+  }
+
+  return true;
+}
+
+void
+utf8_sanitize(std::string& dest, const char* first, const char* last) {
+  dest.reserve(dest.size() + (last - first));
+
+  while (first != last) {
+    const char* ascii = utf8_skip_ascii(first, last, true);
+
+    dest.append(first, ascii);
+
+    if ((first = ascii) == last)
+      break;
+
+    unsigned char c = *first;
+    unsigned int length = utf8_sequence_length((const unsigned char*)first, (const unsigned char*)last);
+
+    if (length == 0 || (c < 0x20 && c != '\t' && c != '\n' && c != '\r')) {
+      dest.push_back('?');
+      first++;
+
+    } else {
+      dest.append(first, first + length);
+      first += length;
+    }
+  }
+}
+
+}